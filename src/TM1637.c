@@ -5,6 +5,7 @@
  * @brief  TM1637 chip driver
  *         Functionalities of the this file:
  *          + Display config and control functions
+ *          + Key scan
  **********************************************************************************
  *
  * Copyright (c) 2023 Mahda Embedded System (MIT License)
@@ -171,6 +172,36 @@ TM1637_WriteBytes(TM1637_Handler_t *Handler,
   return Result;
 }
 
+static uint8_t
+TM1637_ReadByte(TM1637_Handler_t *Handler)
+{
+  uint8_t Data = 0;
+
+  Handler->DioConfigIn();
+  Handler->DioWrite(1);
+
+  for (uint8_t i = 0; i < 8; ++i)
+  {
+    Handler->ClkWrite(0); // the chip shifts the next bit out, LSB first
+    Handler->DelayUs(CommunicationDelayUs);
+    Handler->ClkWrite(1);
+    Handler->DelayUs(CommunicationDelayUs);
+
+    Data >>= 1;
+    if (Handler->DioRead())
+      Data |= 0x80;
+  }
+
+  // 9th clock, the chip releases DIO after it
+  Handler->ClkWrite(0);
+  Handler->DelayUs(CommunicationDelayUs);
+  Handler->ClkWrite(1);
+  Handler->DelayUs(CommunicationDelayUs);
+  Handler->ClkWrite(0);
+
+  return Data;
+}
+
 static int8_t
 TM1637_SetMultipleDisplayRegister(TM1637_Handler_t *Handler,
                                   const uint8_t *DigitData,
@@ -476,4 +507,66 @@ TM1637_SetSingleDigit_HEX(TM1637_Handler_t *Handler,
 
 //   return TM1637_SetMultipleDigit(Handler,
 //                                  (const uint8_t *)DigitDataHEX, StartAddr, Count);
-// }
\ No newline at end of file
+// }
+
+
+
+/**
+ ==================================================================================
+                          ##### Public Key Functions #####                        
+ ==================================================================================
+ */
+
+/**
+ * @brief  Read the key scan register
+ * @note   Only one key is reported at a time. The chip scans the keys while
+ *         it drives the display, so this is only meaningful with the display
+ *         on. Reading clocks at about 100 kHz, under the 250 kHz limit.
+ * @param  Handler: Pointer to handler
+ * @param  ScanCode: Raw scan code, TM1637NoKey when no key is down
+ * @retval TM1637_Result_t
+ *         - TM1637_OK: Operation was successful
+ *         - TM1637_FAIL: The chip did not acknowledge the read command
+ */
+TM1637_Result_t
+TM1637_ScanKeys(TM1637_Handler_t *Handler, uint8_t *ScanCode)
+{
+  uint8_t Data = DataCommandSetting | ReadKeyScanData;
+  int8_t Result = 0;
+
+  TM1637_StartCommunication(Handler);
+  Result = TM1637_WriteBytes(Handler, &Data, 1);
+  if (Result == 0)
+    *ScanCode = TM1637_ReadByte(Handler);
+  TM1637_StopCommunication(Handler);
+
+  if (Result < 0)
+    return TM1637_FAIL;
+
+  return TM1637_OK;
+}
+
+/**
+ * @brief  Convert a scan code to a key number
+ * @note   Bit 4 low is K2, bit 3 low K1 and the three low bits are the
+ *         segment line, inverted: K1 with SG1..SG8 reads 0xF7..0xF0, K2
+ *         with SG1..SG8 0xEF..0xE8. The upper three bits read high.
+ * @param  ScanCode: Scan code from TM1637_ScanKeys
+ * @retval Key number
+ *         - 0: No key
+ *         - 1..8: K1 with SG1..SG8
+ *         - 9..16: K2 with SG1..SG8
+ */
+uint8_t
+TM1637_ScanCodeToKey(uint8_t ScanCode)
+{
+  uint8_t Line = ~ScanCode & 0x07;
+
+  if (!(ScanCode & 0x08))
+    return 1 + Line;  // K1
+
+  if (!(ScanCode & 0x10))
+    return 9 + Line;  // K2
+
+  return 0;
+}
@@ -5,6 +5,7 @@
  * @brief  TM1637 chip driver
  *         Functionalities of the this file:
  *          + Display config and control functions
+ *          + Key scan
  **********************************************************************************
  *
  * Copyright (c) 2023 Mahda Embedded System (MIT License)
@@ -49,6 +50,8 @@ extern "C" {
 
 #define TM1637DecimalPoint    0x80
 
+#define TM1637NoKey           0xFF
+
   
 /* Exported Data Types ----------------------------------------------------------*/
 /**
@@ -191,9 +194,9 @@ TM1637_SetSingleDigit(TM1637_Handler_t *Handler,
  * @retval TM1637_Result_t
  *         - TM1637_OK: Operation was successful
  */
-// TM1637_Result_t
-// TM1637_SetMultipleDigit(TM1637_Handler_t *Handler, const uint8_t *DigitData,
-//                         uint8_t StartAddr, uint8_t Count);
+TM1637_Result_t
+TM1637_SetMultipleDigit(TM1637_Handler_t *Handler, const uint8_t *DigitData,
+                        uint8_t StartAddr, uint8_t Count);
 
 
 /**
@@ -238,6 +241,40 @@ TM1637_SetSingleDigit_HEX(TM1637_Handler_t *Handler,
 
 
 
+/**
+ ==================================================================================
+                             ##### Key Functions #####                            
+ ==================================================================================
+ */
+
+/**
+ * @brief  Read the key scan register
+ * @note   Only one key is reported at a time. The chip scans the keys while
+ *         it drives the display, so this is only meaningful with the display
+ *         on. Reading clocks at about 100 kHz, under the 250 kHz limit.
+ * @param  Handler: Pointer to handler
+ * @param  ScanCode: Raw scan code, TM1637NoKey when no key is down
+ * @retval TM1637_Result_t
+ *         - TM1637_OK: Operation was successful
+ *         - TM1637_FAIL: The chip did not acknowledge the read command
+ */
+TM1637_Result_t
+TM1637_ScanKeys(TM1637_Handler_t *Handler, uint8_t *ScanCode);
+
+
+/**
+ * @brief  Convert a scan code to a key number
+ * @param  ScanCode: Scan code from TM1637_ScanKeys
+ * @retval Key number
+ *         - 0: No key
+ *         - 1..8: K1 with SG1..SG8
+ *         - 9..16: K2 with SG1..SG8
+ */
+uint8_t
+TM1637_ScanCodeToKey(uint8_t ScanCode);
+
+
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,242 @@
+// Host microbenchmarks of the hot paths.
+//
+// Built by make -f Makefile.host bench, linked against the host
+// backend without main.c. Each case runs until it has taken at least
+// BENCH_MIN_NS, the best of BENCH_RUNS runs is reported. Interrupts
+// are never enabled, so the backend's emulation stays out of the way
+// apart from the pin accessors being function calls. The formatting
+// cases include the backend's UART drain, a stdio write per character,
+// so they compare against themselves, not against the AVR.
+//
+// malloc and friends are wrapped at link time: a case that allocates
+// shows it in "allocs" and fails the run.
+//
+// Output is one JSON object on stdout, tools/bench.py reads it.
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "hal.h"
+#include "fstop.h"
+#include "paper.h"
+#include "max7219.h"
+#include "display.h"
+#include "rotary.h"
+#include "TM1637.h"
+#include "fmt.h"
+
+#define BENCH_MIN_NS 20000000ULL
+#define BENCH_RUNS   5
+
+typedef struct {
+    const char *name;
+    const char *symbol;  // the AVR function the case exercises
+    void (*run)(uint32_t i);
+} bench_t;
+
+static unsigned long allocs;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *p, size_t size);
+
+void *__wrap_malloc(size_t size) {
+    allocs++;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t n, size_t size) {
+    allocs++;
+    return __real_calloc(n, size);
+}
+
+void *__wrap_realloc(void *p, size_t size) {
+    allocs++;
+    return __real_realloc(p, size);
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* Cases ---------------------------------------------------------------- */
+
+static fstop_t stops;
+
+// Base change followed by the read that recomputes the table
+static void run_fstop_refresh(uint32_t i) {
+    fstop_set_base(&stops, 5.0 + (i & 7));
+    fstop_at(&stops, 0);
+}
+
+// One interval up and back down on a clean table
+static void run_fstop_shift(uint32_t i) {
+    fstop_shift(&stops, (i & 1) ? -1 : 1);
+}
+
+// A test strip detent: shift, base back to its tenth, read
+static void run_fstop_detent(uint32_t i) {
+    fstop_shift(&stops, (i & 1) ? -1 : 1);
+    fstop_rescale(&stops, (long) (fstop_base(&stops) * 10.0 + 0.5) / 10.0);
+    fstop_at(&stops, 0);
+}
+
+// Program offset past the end of the table
+static void run_fstop_at(uint32_t i) {
+    fstop_at(&stops, (i & 1) ? 9 : -9);
+}
+
+// Fibre profile over 1 to 512 s, the reciprocity table walked
+static void run_paper_correct(uint32_t i) {
+    paper_correct(2, 1000 + (i & 511) * 1000);
+}
+
+static void run_display(uint32_t i) {
+    MAX7219_displayNumber(i % 10000);
+}
+
+// Encoder at rest, the common case of the poll interrupt
+static void run_rotary_idle(uint32_t i) {
+    rotary_check_status();
+}
+
+// One detent clockwise, the four decoder steps of a turn
+static void run_rotary_turn(uint32_t i) {
+    static const uint8_t walk[4] = {
+        ROTARY_AB(1, 0), ROTARY_AB(0, 0), ROTARY_AB(0, 1), ROTARY_AB(1, 1)
+    };
+    static uint8_t state;
+
+    for (uint8_t n = 0; n < 4; n++) {
+        state = rotary_step(state, walk[n]);
+    }
+}
+
+static void tm_nop(void) {
+}
+
+static void tm_write(uint8_t level) {
+}
+
+static uint8_t tm_ack(void) {
+    return 0;
+}
+
+static void tm_delay(uint8_t us) {
+}
+
+static TM1637_Handler_t tm = {
+    .PlatformInit = tm_nop,
+    .PlatformDeInit = tm_nop,
+    .DioConfigOut = tm_nop,
+    .DioConfigIn = tm_nop,
+    .DioWrite = tm_write,
+    .DioRead = tm_ack,
+    .ClkWrite = tm_write,
+    .DelayUs = tm_delay,
+};
+
+// Four digits, the bit loop of TM1637_WriteBytes with free pins
+static void run_tm1637(uint32_t i) {
+    static const uint8_t digits[4] = {0x3F, 0x06, 0x5B, 0x4F};
+
+    TM1637_SetMultipleDigit(&tm, digits, 0, 4);
+}
+
+static void run_put_u32(uint32_t i) {
+    put_u32(i * 2654435761u);
+}
+
+static void run_put_fixed(uint32_t i) {
+    put_fixed(i * 2654435761u, 3);
+}
+
+static const bench_t cases[] = {
+    { "fstop_refresh", "fstop_at", run_fstop_refresh },
+    { "fstop_shift", "fstop_shift", run_fstop_shift },
+    { "fstop_detent", "fstop_rescale", run_fstop_detent },
+    { "fstop_at_outside", "fstop_at", run_fstop_at },
+    { "paper_correct", "paper_correct", run_paper_correct },
+    { "max7219_display_number", "MAX7219_displayNumber", run_display },
+    { "rotary_idle", "rotary_check_status", run_rotary_idle },
+    { "rotary_turn", "rotary_step", run_rotary_turn },
+    { "tm1637_write_4_digits", "TM1637_SetMultipleDigit", run_tm1637 },
+    { "put_u32", "put_u32", run_put_u32 },
+    { "put_fixed", "put_fixed", run_put_fixed },
+};
+
+/* Driver --------------------------------------------------------------- */
+
+// Shortest time per op over BENCH_RUNS runs of at least BENCH_MIN_NS.
+static double measure(const bench_t *b, uint64_t *ops) {
+    uint64_t n = 1;
+    double best = 0;
+
+    // Grow the count until one run is long enough to time
+    for (;;) {
+        uint64_t start = now_ns();
+
+        for (uint64_t i = 0; i < n; i++) {
+            b->run(i);
+        }
+        if (now_ns() - start >= BENCH_MIN_NS) {
+            break;
+        }
+        n *= 2;
+    }
+
+    for (uint8_t r = 0; r < BENCH_RUNS; r++) {
+        uint64_t start = now_ns();
+        double ns;
+
+        for (uint64_t i = 0; i < n; i++) {
+            b->run(i);
+        }
+        ns = (double) (now_ns() - start) / n;
+        if (!r || ns < best) {
+            best = ns;
+        }
+    }
+
+    *ops = n;
+    return best;
+}
+
+int main(void) {
+    // Results go to the real stdout, the UART output of the
+    // formatting cases to /dev/null
+    FILE *out = fdopen(dup(STDOUT_FILENO), "w");
+    uint8_t failed = 0;
+
+    if (!out || !freopen("/dev/null", "w", stdout)) {
+        return 2;
+    }
+
+    hal_init();
+    spiMasterInit();
+    display_init(0);
+    init_rotary();
+    fstop_init(&stops, 10.0, 0.5);
+    fstop_at(&stops, 0);
+
+    fprintf(out, "{\"cases\": [");
+    for (uint8_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        uint64_t ops;
+        unsigned long before = allocs;
+        double ns = measure(&cases[c], &ops);
+
+        failed |= allocs != before;
+        fprintf(out, "%s\n  {\"name\": \"%s\", \"symbol\": \"%s\", \"ns_per_op\": %.2f, "
+                "\"ops\": %llu, \"allocs\": %lu}",
+                c ? "," : "", cases[c].name, cases[c].symbol, ns,
+                (unsigned long long) ops, allocs - before);
+    }
+    fprintf(out, "\n]}\n");
+    fclose(out);
+
+    return failed;
+}
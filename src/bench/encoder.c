@@ -0,0 +1,400 @@
+// Encoder fuzzing and replay harness for rotary_step() and the click
+// debounce.
+//
+// Built by make -f Makefile.host encoder. Four checks, all against
+// the code the firmware runs:
+//
+//   direct   synthetic turns with contact bounce, every transition fed
+//            to the decoder: the count must match exactly
+//   sampled  the same waveforms sampled at the input poll period with
+//            a random phase, swept over turning speeds: a detent may
+//            be lost, but never counted twice or the wrong way. The
+//            fastest speed without a loss is reported. Past half a
+//            detent per poll the samples alias, three quarter steps
+//            forward look like one back, so wrong counts there are
+//            shown but do not fail the check.
+//   click    presses of the encoder button with contact bounce on
+//            both edges, and bounce bursts with no press, sampled by
+//            rotary_check_status() at the poll period: every press
+//            must count exactly once and bounce alone never
+//   replay   A/B samples recorded on the device with 'enc', fed in
+//            poll by poll: the count must match what the device
+//            counted (tools/encoder.py fetches the recording)
+//
+//   timer_encoder [--seed n] [--bounce-us n] [--poll-us n] [--replay file]
+//
+// Exits non-zero when a check fails.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "rotary.h"
+
+#define DIRECT_DETENTS  1000000
+#define SAMPLED_DETENTS 4000
+#define SPIN_MAX        40          // detents in one spin before a pause
+#define RATE_MIN        5           // detents per second
+#define RATE_MAX        200
+#define RATE_STEP       5
+#define EDGES_MAX       (SPIN_MAX * 4 * 16)
+#define CLICKS          20000
+#define CLICK_BATCH     100         // presses in one sampled sequence
+
+typedef struct {
+    uint64_t t_ns;
+    uint8_t ab;             // both lines after this transition
+} edge_t;
+
+typedef struct {
+    uint32_t cw;
+    uint32_t ccw;
+} count_t;
+
+static uint32_t seed = 1;
+static uint32_t bounce_us = 1000;
+static uint32_t poll_us = HAL_POLL_US;
+
+static edge_t edges[EDGES_MAX];
+
+static uint32_t rnd(void) {
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+// Uniform in [lo, hi)
+static double rnd_range(double lo, double hi) {
+    return lo + (hi - lo) * (rnd() / 4294967296.0);
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* Waveforms ------------------------------------------------------------ */
+
+// A spin of detents turns at about rate detents/s, each detent a little
+// faster or slower and with uneven quarters, as a hand turns it. Every
+// edge bounces a few times for up to bounce_us, never past a third of
+// its quarter. Returns the number of transitions written from t_ns on.
+static uint16_t spin(uint64_t t_ns, int8_t direction, uint16_t detents, double rate) {
+    // Line that changes at each quarter, CW leads with B
+    static const uint8_t cw_line[4] = {2, 1, 2, 1};
+    static const uint8_t ccw_line[4] = {1, 2, 1, 2};
+    const uint8_t *line = direction > 0 ? cw_line : ccw_line;
+    uint8_t ab = 3;
+    uint16_t n = 0;
+
+    for (uint16_t d = 0; d < detents; d++) {
+        double detent_ns = 1e9 / rate * rnd_range(0.8, 1.25);
+        double quarter[4];
+        double sum = 0;
+
+        for (uint8_t q = 0; q < 4; q++) {
+            quarter[q] = rnd_range(0.15, 0.35);
+            sum += quarter[q];
+        }
+
+        for (uint8_t q = 0; q < 4; q++) {
+            uint64_t length = detent_ns * quarter[q] / sum;
+            uint64_t window = bounce_us * 1000ULL;
+            uint8_t bounces = rnd() % 4;
+
+            if (window > length / 3) {
+                window = length / 3;
+            }
+
+            // Each bounce is a pair of transitions, back and forth again
+            ab ^= line[q];
+            edges[n++] = (edge_t) { t_ns, ab };
+            for (uint8_t b = 0; b < bounces && window; b++) {
+                uint64_t at = t_ns + window * (b + 1) / (bounces + 1);
+
+                edges[n++] = (edge_t) { at, ab ^ line[q] };
+                edges[n++] = (edge_t) { at + window / (2 * (bounces + 1)), ab };
+            }
+            t_ns += length;
+        }
+    }
+
+    return n;
+}
+
+static void tally(count_t *count, uint8_t state) {
+    if (state & ROTARY_CW) {
+        count->cw++;
+    } else if (state & ROTARY_CCW) {
+        count->ccw++;
+    }
+}
+
+/* Checks --------------------------------------------------------------- */
+
+static int check_direct(void) {
+    uint64_t transitions = 0;
+    uint64_t elapsed = 0;
+    uint32_t done = 0;
+    int failed = 0;
+
+    while (done < DIRECT_DETENTS) {
+        int8_t direction = rnd() & 1 ? 1 : -1;
+        uint16_t detents = 1 + rnd() % SPIN_MAX;
+        uint16_t n = spin(0, direction, detents, rnd_range(RATE_MIN, 1000));
+        count_t count = {0, 0};
+        uint8_t state = 0;
+        uint64_t start = now_ns();
+
+        for (uint16_t i = 0; i < n; i++) {
+            state = rotary_step(state, edges[i].ab);
+            tally(&count, state);
+        }
+        elapsed += now_ns() - start;
+        transitions += n;
+        done += detents;
+
+        if (count.cw != (direction > 0 ? detents : 0) || count.ccw != (direction < 0 ? detents : 0)) {
+            if (!failed) {
+                printf("direct: %u detents %s counted %u cw %u ccw\n", detents,
+                       direction > 0 ? "cw" : "ccw", count.cw, count.ccw);
+            }
+            failed = 1;
+        }
+    }
+
+    printf("direct   %u detents, %llu transitions, %.1f M transitions/s, %s\n",
+           done, (unsigned long long) transitions, transitions * 1e3 / elapsed,
+           failed ? "FAIL" : "ok");
+    return failed;
+}
+
+// Samples the spin at the poll period from a random phase.
+static count_t sample(uint16_t n, uint64_t end_ns) {
+    count_t count = {0, 0};
+    uint64_t t = rnd_range(0, poll_us) * 1000;
+    uint8_t state = 0;
+    uint8_t ab = 3;
+    uint16_t i = 0;
+
+    // One poll past the end so the final rest is seen
+    for (; t <= end_ns + poll_us * 1000ULL; t += poll_us * 1000ULL) {
+        while (i < n && edges[i].t_ns <= t) {
+            ab = edges[i++].ab;
+        }
+        state = rotary_step(state, ab);
+        tally(&count, state);
+    }
+
+    return count;
+}
+
+static int check_sampled(void) {
+    uint32_t alias_rate = 1000000 / (2 * poll_us);
+    uint16_t lossless = 0;
+    int failed = 0;
+
+    printf("sampled  poll %u us, bounce up to %u us, aliasing from %u detents/s\n",
+           poll_us, bounce_us, alias_rate);
+    printf("%8s %8s %8s %8s\n", "det/s", "turned", "lost", "wrong");
+
+    for (uint16_t rate = RATE_MIN; rate <= RATE_MAX; rate += RATE_STEP) {
+        uint32_t turned = 0;
+        uint32_t lost = 0;
+        uint32_t wrong = 0;
+
+        while (turned < SAMPLED_DETENTS) {
+            int8_t direction = rnd() & 1 ? 1 : -1;
+            uint16_t detents = 1 + rnd() % SPIN_MAX;
+            uint16_t n = spin(0, direction, detents, rate);
+            count_t count = sample(n, edges[n - 1].t_ns);
+            uint32_t right = direction > 0 ? count.cw : count.ccw;
+
+            wrong += (direction > 0 ? count.ccw : count.cw) + (right > detents ? right - detents : 0);
+            lost += right < detents ? detents - right : 0;
+            turned += detents;
+        }
+
+        printf("%8u %8u %8u %8u\n", rate, turned, lost, wrong);
+        if (!lost && lossless == rate - RATE_STEP) {
+            lossless = rate;
+        }
+        failed |= wrong && rate < alias_rate;
+    }
+
+    printf("sampled  no loss up to %u detents/s, %s\n", lossless, failed ? "FAIL" : "ok");
+    return failed;
+}
+
+// A bounce burst around t_ns: up to three short pulses to level
+// within window_ns, the line back at its previous level after each.
+static uint16_t burst(uint16_t n, uint64_t t_ns, uint64_t window_ns, uint8_t level) {
+    uint8_t pulses = 1 + rnd() % 3;
+
+    for (uint8_t b = 0; b < pulses; b++) {
+        uint64_t at = t_ns + window_ns * b / pulses;
+
+        edges[n++] = (edge_t) { at, level };
+        edges[n++] = (edge_t) { at + window_ns / (2 * pulses), !level };
+    }
+
+    return n;
+}
+
+// Feeds the button line to rotary_check_status() poll by poll from a
+// random phase, returns the presses it reported.
+static uint32_t click_sample(uint16_t n, uint64_t end_ns) {
+    uint64_t t = rnd_range(0, poll_us) * 1000;
+    uint32_t presses = 0;
+    uint16_t i = 0;
+
+    hal_gpio_write(PIN_ROT_SW, 1);
+    for (; t <= end_ns + 3 * poll_us * 1000ULL; t += poll_us * 1000ULL) {
+        while (i < n && edges[i].t_ns <= t) {
+            hal_gpio_write(PIN_ROT_SW, edges[i++].ab);
+        }
+        rotary_check_status();
+        if (rotary_get_status()) {
+            presses++;
+            rotary_reset_status();
+        }
+    }
+
+    return presses;
+}
+
+// The debounce wants the line low on two polls in a row, so a press
+// is held for at least three polls and a burst is kept shorter than
+// one, as the bounce of a real switch is.
+static int check_click(void) {
+    uint64_t poll_ns = poll_us * 1000ULL;
+    uint64_t window_ns = bounce_us * 1000ULL < poll_ns ? bounce_us * 1000ULL : poll_ns - 1000;
+    uint32_t clicks = 0;
+    uint32_t counted = 0;
+    uint32_t noise = 0;
+
+    hal_gpio_write(PIN_ROT_A, 1);
+    hal_gpio_write(PIN_ROT_B, 1);
+
+    while (clicks < CLICKS) {
+        uint64_t t = 0;
+        uint16_t n = 0;
+
+        for (uint16_t c = 0; c < CLICK_BATCH; c++) {
+            uint64_t held = rnd_range(3 * poll_ns, 300e6);
+
+            t += rnd_range(3 * poll_ns, 200e6);
+            n = burst(n, t, window_ns, 1);         // bouncing onto the contact
+            edges[n++] = (edge_t) { t + window_ns, 0 };
+            t += held;
+            edges[n++] = (edge_t) { t, 1 };
+            n = burst(n, t, window_ns, 0);         // and off it
+        }
+        counted += click_sample(n, t);
+        clicks += CLICK_BATCH;
+
+        t = 0;
+        n = 0;
+        for (uint16_t c = 0; c < CLICK_BATCH; c++) {
+            t += rnd_range(2 * poll_ns, 100e6);
+            n = burst(n, t, window_ns, 0);
+        }
+        noise += click_sample(n, t);
+    }
+
+    printf("click    %u presses, bounce up to %.0f us, %u counted, %u from bounce alone, %s\n",
+           clicks, window_ns / 1e3, counted, noise, counted == clicks && !noise ? "ok" : "FAIL");
+    return counted != clicks || noise;
+}
+
+static int replay(const char *path) {
+    static uint8_t data[8 + 65536 / 4];
+    FILE *f = fopen(path, "rb");
+    size_t size;
+    uint8_t *p;
+    uint16_t samples;
+    uint16_t period_us;
+    int16_t device;
+    count_t count = {0, 0};
+    uint8_t state = 0;
+    uint32_t last = 0;
+    uint32_t fastest = 0;
+
+    if (!f) {
+        perror(path);
+        return 1;
+    }
+    size = fread(data, 1, sizeof(data), f);
+    fclose(f);
+
+    p = memchr(data, 'E', size);
+    while (p && (p + 8 > data + size || p[1] != 'N')) {
+        p = memchr(p + 1, 'E', data + size - p - 1);
+    }
+    if (!p) {
+        printf("replay: no capture header in %s\n", path);
+        return 1;
+    }
+    samples = p[2] | p[3] << 8;
+    period_us = p[4] | p[5] << 8;
+    device = p[6] | p[7] << 8;
+    p += 8;
+    if (p + (samples + 3) / 4 > data + size) {
+        printf("replay: short capture, %u samples announced\n", samples);
+        return 1;
+    }
+
+    for (uint32_t i = 0; i < samples; i++) {
+        state = rotary_step(state, p[i / 4] >> (2 * (i % 4)));
+        if (state & (ROTARY_CW | ROTARY_CCW)) {
+            if (count.cw + count.ccw && (!fastest || i - last < fastest)) {
+                fastest = i - last;
+            }
+            last = i;
+        }
+        tally(&count, state);
+    }
+
+    printf("replay   %u samples at %u us, %u cw %u ccw, device counted %d, fastest %.1f detents/s, %s\n",
+           samples, period_us, count.cw, count.ccw, device,
+           fastest ? 1e6 / (fastest * period_us) : 0.0,
+           (int16_t) (count.cw - count.ccw) == device ? "ok" : "FAIL");
+    return (int16_t) (count.cw - count.ccw) != device;
+}
+
+int main(int argc, char **argv) {
+    const char *replay_path = NULL;
+    int failed = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+            seed = strtoul(argv[++i], NULL, 0);
+        } else if (!strcmp(argv[i], "--bounce-us") && i + 1 < argc) {
+            bounce_us = strtoul(argv[++i], NULL, 0);
+        } else if (!strcmp(argv[i], "--poll-us") && i + 1 < argc) {
+            poll_us = strtoul(argv[++i], NULL, 0);
+        } else if (!strcmp(argv[i], "--replay") && i + 1 < argc) {
+            replay_path = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [--seed n] [--bounce-us n] [--poll-us n] [--replay file]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (!seed || !poll_us) {
+        fprintf(stderr, "seed and poll period must not be 0\n");
+        return 2;
+    }
+
+    if (replay_path) {
+        return replay(replay_path);
+    }
+
+    failed |= check_direct();
+    failed |= check_sampled();
+    failed |= check_click();
+
+    return failed;
+}
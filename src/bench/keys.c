@@ -0,0 +1,29 @@
+// Key scan decode check for TM1637_ScanCodeToKey().
+//
+// Built and run by make -f Makefile.host keys. Feeds the decoder every
+// scan code the TM1637 datasheet lists, K1 with SG1..SG8 as 0xF7..0xF0
+// and K2 with SG1..SG8 as 0xEF..0xE8, which must come out as keys 1..8
+// and 9..16, and TM1637NoKey, which must come out as no key.
+//
+// Exits non-zero when a code decodes wrong.
+#include <stdio.h>
+#include <stdint.h>
+
+#include "TM1637.h"
+
+int main(void) {
+    int failed = 0;
+
+    for (uint8_t key = 0; key <= 16; key++) {
+        uint8_t code = key == 0 ? TM1637NoKey : key <= 8 ? 0xF8 - key : 0xF0 - (key - 8);
+        uint8_t got = TM1637_ScanCodeToKey(code);
+
+        if (got != key) {
+            printf("keys     0x%02X decodes to %u, expected %u\n", code, got, key);
+            failed = 1;
+        }
+    }
+
+    printf("keys     17 codes, %s\n", failed ? "FAIL" : "ok");
+    return failed;
+}
@@ -0,0 +1,476 @@
+// Cycle counts of the AVR image under simavr.
+//
+// Built and run by make simtest, against the .elf the AVR build made.
+// The harness loads it into a simulated atmega328p at F_CPU and wires
+// up the pins of boards/$(BOARD): the panel inputs held released, a
+// virtual encoder on the A and B pins, and a virtual MAX7219 on the
+// SPI output and LOAD, which keeps the digit registers as the display
+// would. It waits for "Ready" on the UART, turns the encoder --turn
+// detents, reads the set time off the digits and presses START, which
+// runs that exposure, and watches the core instruction by instruction
+// until the relay has gone off:
+//
+//   boot     cycles from reset to the "Ready" line being sent
+//   turn     change of the displayed time over the turn, one
+//            BASE_STEP_DS per detent
+//   ticks    Timer1 compare interrupts between the relay edges, must
+//            equal the ms shown at START
+//   jitter   spread of the tick vectors around a grid of exactly
+//            F_CPU / 1000 cycles, from the tick before the relay went
+//            on, the drift correction being blank: how much later one
+//            tick got in than another
+//   relay    cycles the relay was on, against the ms less the phase of
+//            the start within its tick, plus the edge. Only the
+//            latencies of the first and last tick vectors are not
+//            known, so it may be off by no more than the jitter
+//   edge     cycles from the tick interrupt's vector to the relay
+//            going off in it
+//   isr      per vector, count and longest run from the vector to
+//            the end of its reti
+//   cli      longest stretch with interrupts off outside any
+//            interrupt, how late the tick can be on top of edge
+//
+// turn, ticks and relay are exact and always checked. The cycle counts,
+// boot, jitter, edge, cli and the vectors, have no limits of their own:
+// --record writes what a run measured plus --margin percent, at least
+// MARGIN_MIN cycles, to a limits file, one "name cycles" per line, and
+// --limits checks a later run against it. Without --limits they are
+// only reported.
+//
+// The run stays short of POWER_IDLE_MS before START, so the clock
+// scaling, which rests on CLKPR, does not come into it.
+//
+//   timer_sim [--turn detents] [--limits file] [--record file [--margin pct]]
+//             [-v] image.elf
+//
+// Exits non-zero when a check fails or a limit is exceeded. Needs
+// simavr 1.6 or later, and libelf.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <simavr/sim_avr.h>
+#include <simavr/sim_elf.h>
+#include <simavr/sim_irq.h>
+#include <simavr/avr_ioport.h>
+#include <simavr/avr_uart.h>
+#include <simavr/avr_spi.h>
+
+#include "board.h"
+
+// Port letter and bit of a board pin
+#define SIM_PIN(pin)        SIM_PIN_(pin)
+#define SIM_PIN_(port, bit) { #port[0], bit }
+
+#define TICK_VECTOR   11        // TIMER1_COMPA on the atmega328p
+#define TICK          (F_CPU / 1000)
+#define VECTORS       26
+#define OP_RETI       0x9518
+
+#define BOOT_LIMIT    (F_CPU * 2)
+#define TURN_AT       (F_CPU / 20)          // after "Ready"
+#define TURN_STEP     (F_CPU / 125)         // per A/B change, two polls
+#define PRESS_AFTER   (F_CPU / 10)          // after the turn
+#define PRESS_FOR     (F_CPU / 10)
+#define AFTER_OFF     (F_CPU / 20)
+
+#define MARGIN_MIN    16                    // cycles, a few instructions
+#define LIMITS_MAX    (VECTORS + 8)
+
+#define DETENT_DS     10                    // BASE_STEP_DS, src/ui.c
+#define MAX7219_BLANK 0x0F                  // code B, and 0x0A is '-'
+
+typedef struct {
+    char port;
+    uint8_t bit;
+} pin_t;
+
+typedef struct {
+    uint32_t count;
+    avr_cycle_count_t worst;
+} isr_t;
+
+typedef struct {
+    char name[16];
+    unsigned long long cycles;
+} limit_t;
+
+static const char vector_names[VECTORS][14] = {
+    "RESET", "INT0", "INT1", "PCINT0", "PCINT1", "PCINT2", "WDT",
+    "TIMER2_COMPA", "TIMER2_COMPB", "TIMER2_OVF", "TIMER1_CAPT",
+    "TIMER1_COMPA", "TIMER1_COMPB", "TIMER1_OVF", "TIMER0_COMPA",
+    "TIMER0_COMPB", "TIMER0_OVF", "SPI_STC", "USART_RX", "USART_UDRE",
+    "USART_TX", "ADC", "EE_READY", "ANALOG_COMP", "TWI", "SPM_READY"
+};
+
+// Held high, released, for the whole run unless driven below
+static const pin_t inputs[] = {
+    SIM_PIN(PIN_SENSE), SIM_PIN(PIN_ROT_A), SIM_PIN(PIN_ROT_B), SIM_PIN(PIN_ROT_SW),
+    SIM_PIN(PIN_START), SIM_PIN(PIN_TOGGLE), SIM_PIN(PIN_MODE),
+};
+static const pin_t relay_pin = SIM_PIN(PIN_RELAY);
+static const pin_t start_pin = SIM_PIN(PIN_START);
+static const pin_t rot_a_pin = SIM_PIN(PIN_ROT_A);
+static const pin_t rot_b_pin = SIM_PIN(PIN_ROT_B);
+static const pin_t load_pin = SIM_PIN(PIN_SPI_SS);
+
+// A and B from rest, both high, through one detent clockwise
+static const uint8_t detent_cw[4][2] = { { 1, 0 }, { 0, 0 }, { 0, 1 }, { 1, 1 } };
+
+static avr_t *avr;
+static int verbose;
+
+static char line[80];
+static uint8_t line_len;
+static avr_cycle_count_t ready_at;
+
+static int turn = 2;                        // detents, negative counter-clockwise
+static uint32_t set_ms;                     // shown at START
+static long shown_before;                   // before the turn
+static long shown_after;
+
+static uint8_t spi_last[2];                 // register, data
+static uint8_t digits[DISPLAY_DIGITS + 1];  // by MAX7219 register, 1 rightmost
+static int load_level = 1;
+static int display_written;
+
+static avr_cycle_count_t relay_on_at;
+static avr_cycle_count_t relay_off_at;
+static avr_cycle_count_t tick_at;           // last tick vector
+static avr_cycle_count_t phase;             // that tick to relay on
+static avr_cycle_count_t edge;              // tick vector to relay off
+static uint32_t ticks;                      // between the relay edges
+static avr_cycle_count_t grid_min;          // tick vector less ticks * TICK
+static avr_cycle_count_t grid_max;
+
+static isr_t isrs[VECTORS];
+static avr_cycle_count_t cli_worst;
+
+static limit_t limits[LIMITS_MAX];
+static int limit_count;
+static FILE *record;
+static unsigned margin = 25;                // percent
+
+static void uart_out(struct avr_irq_t *irq, uint32_t value, void *param) {
+    if (value == '\n' || line_len == sizeof(line) - 1) {
+        line[line_len] = '\0';
+        line_len = 0;
+        if (verbose) {
+            fprintf(stderr, "[%10.6f] %s\n", (double) avr->cycle / F_CPU, line);
+        }
+        if (!ready_at && strncmp(line, "Ready", 5) == 0) {
+            ready_at = avr->cycle;
+        }
+    } else if (value != '\r') {
+        line[line_len++] = value;
+    }
+}
+
+static avr_irq_t *pin_irq(pin_t pin) {
+    return avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ(pin.port), pin.bit);
+}
+
+static void spi_out(struct avr_irq_t *irq, uint32_t value, void *param) {
+    spi_last[0] = spi_last[1];
+    spi_last[1] = value;
+}
+
+// The MAX7219 takes the last 16 bits shifted in on the rising LOAD.
+static void load(struct avr_irq_t *irq, uint32_t value, void *param) {
+    uint8_t reg = spi_last[0] & 0x0F;
+
+    if (value && !load_level && reg >= 1 && reg <= DISPLAY_DIGITS) {
+        digits[reg] = spi_last[1];
+        display_written = 1;
+    }
+    load_level = value;
+}
+
+// The number on the digits, point and blanks left out, -1 if there is
+// none yet.
+static long shown(void) {
+    long number = 0;
+
+    if (!display_written) {
+        return -1;
+    }
+    for (int reg = DISPLAY_DIGITS; reg >= 1; reg--) {
+        uint8_t code = digits[reg] & 0x0F;
+
+        if (code <= 9) {
+            number = number * 10 + code;
+        }
+    }
+
+    return number;
+}
+
+// Step n of the turn, four to a detent.
+static void encoder(uint32_t n) {
+    const uint8_t *ab = detent_cw[turn > 0 ? n % 4 : (6 - n % 4) % 4];
+
+    avr_raise_irq(pin_irq(rot_a_pin), ab[0]);
+    avr_raise_irq(pin_irq(rot_b_pin), ab[1]);
+}
+
+// The tick before the start is the grid's first line.
+static void relay(struct avr_irq_t *irq, uint32_t value, void *param) {
+    if (value && !relay_on_at) {
+        relay_on_at = avr->cycle;
+        phase = avr->cycle - tick_at;
+        grid_min = grid_max = tick_at;
+    } else if (!value && relay_on_at && !relay_off_at) {
+        relay_off_at = avr->cycle;
+        edge = avr->cycle - tick_at;
+    }
+}
+
+// The tick that turns the relay off gets here first, so it counts.
+static void tick(avr_cycle_count_t now) {
+    tick_at = now;
+    if (relay_on_at && !relay_off_at) {
+        avr_cycle_count_t grid;
+
+        ticks++;
+        grid = now - (avr_cycle_count_t) ticks * TICK;
+
+        if (grid < grid_min) {
+            grid_min = grid;
+        }
+        if (grid > grid_max) {
+            grid_max = grid;
+        }
+    }
+}
+
+// Runs the image until the relay has been off for AFTER_OFF, or until
+// it is plain that it won't, following every interrupt in and out.
+static int run(void) {
+    int vector = -1;
+    avr_cycle_count_t isr_at = 0;
+    avr_cycle_count_t cli_at = 0;
+    int started = 0;                        // interrupts on once
+    uint32_t steps = 4 * abs(turn);
+    uint32_t step = 0;
+    avr_cycle_count_t press_at = TURN_AT + steps * TURN_STEP + PRESS_AFTER;
+    avr_cycle_count_t limit = BOOT_LIMIT + press_at + PRESS_FOR;
+    int pressed = 0;
+
+    while (avr->cycle < limit) {
+        avr_flashaddr_t pc = avr->pc;
+        uint16_t op = avr->flash[pc] | avr->flash[pc + 1] << 8;
+        int state = avr_run(avr);
+
+        if (state == cpu_Done || state == cpu_Crashed) {
+            fprintf(stderr, "core stopped at pc 0x%04x\n", (unsigned) avr->pc);
+            return 0;
+        }
+
+        if (vector >= 0 && op == OP_RETI && pc != avr->pc) {
+            avr_cycle_count_t length = avr->cycle - isr_at;
+
+            isrs[vector].count++;
+            if (length > isrs[vector].worst) {
+                isrs[vector].worst = length;
+            }
+            vector = -1;
+        }
+        if (vector < 0 && avr->pc >= avr->vector_size && avr->pc < VECTORS * avr->vector_size) {
+            vector = avr->pc / avr->vector_size;
+            isr_at = avr->cycle;
+            if (vector == TICK_VECTOR) {
+                tick(avr->cycle);
+            }
+        }
+
+        if (vector < 0) {
+            if (avr->sreg[S_I]) {
+                if (cli_at && avr->cycle - cli_at > cli_worst) {
+                    cli_worst = avr->cycle - cli_at;
+                }
+                cli_at = 0;
+                started = 1;
+            } else if (started && !cli_at) {
+                cli_at = avr->cycle;
+            }
+        } else {
+            cli_at = 0;
+        }
+
+        if (ready_at && step < steps && avr->cycle - ready_at >= TURN_AT + step * TURN_STEP) {
+            if (step == 0) {
+                shown_before = shown();
+            }
+            encoder(step++);
+        }
+        if (ready_at && pressed != (avr->cycle - ready_at >= press_at
+                                    && avr->cycle - ready_at < press_at + PRESS_FOR)) {
+            pressed = !pressed;
+            if (pressed) {
+                if (!steps) {
+                    shown_before = shown();
+                }
+                shown_after = shown();
+                if (shown_after <= 0) {
+                    fprintf(stderr, "nothing on the display\n");
+                    return 0;
+                }
+                set_ms = shown_after * 1000;
+                for (int d = 0; d < DISPLAY_DECIMALS; d++) {
+                    set_ms /= 10;
+                }
+                limit = avr->cycle + (avr_cycle_count_t) set_ms * TICK * 2 + F_CPU;
+            }
+            avr_raise_irq(pin_irq(start_pin), !pressed); // active low
+        }
+        if (relay_off_at && avr->cycle - relay_off_at >= AFTER_OFF) {
+            return 1;
+        }
+    }
+
+    fprintf(stderr, "%s\n", !ready_at ? "no Ready line" : !relay_on_at ? "relay never on"
+            : "relay never off");
+    return 0;
+}
+
+static int check(const char *what, unsigned long long value, unsigned long long limit, int ok) {
+    printf("  %-14s %12llu %12llu  %s\n", what, value, limit, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+static int load_limits(const char *path) {
+    FILE *f = fopen(path, "r");
+
+    if (!f) {
+        return 0;
+    }
+    while (limit_count < LIMITS_MAX
+           && fscanf(f, "%15s %llu", limits[limit_count].name, &limits[limit_count].cycles) == 2) {
+        limit_count++;
+    }
+    fclose(f);
+
+    return 1;
+}
+
+// A cycle count: checked against its limit if the file has one, and
+// recorded with the margin.
+static int measure(const char *what, unsigned long long value, const char *note) {
+    unsigned long long pad = value * margin / 100;
+
+    if (record) {
+        fprintf(record, "%s %llu\n", what, value + (pad > MARGIN_MIN ? pad : MARGIN_MIN));
+    }
+    for (int i = 0; i < limit_count; i++) {
+        if (!strcmp(limits[i].name, what)) {
+            printf("  %-14s %12llu %12llu  %s%s\n", what, value, limits[i].cycles,
+                   value <= limits[i].cycles ? "ok" : "FAIL", note);
+            return value <= limits[i].cycles;
+        }
+    }
+    printf("  %-14s %12llu %12s  no limit%s\n", what, value, "-", note);
+
+    return 1;
+}
+
+int main(int argc, char **argv) {
+    const char *image = NULL;
+    long detent = DETENT_DS;                // on the display
+    long long expect;
+    const char *limits_path = NULL;
+    const char *record_path = NULL;
+    char note[32];
+    elf_firmware_t firmware;
+    uint32_t flags = 0;
+    int ok = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--turn") && i + 1 < argc) {
+            turn = strtol(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--limits") && i + 1 < argc) {
+            limits_path = argv[++i];
+        } else if (!strcmp(argv[i], "--record") && i + 1 < argc) {
+            record_path = argv[++i];
+        } else if (!strcmp(argv[i], "--margin") && i + 1 < argc) {
+            margin = strtoul(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "-v")) {
+            verbose = 1;
+        } else {
+            image = argv[i];
+        }
+    }
+    if (!image) {
+        fprintf(stderr, "usage: timer_sim [--turn detents] [--limits file] "
+                "[--record file [--margin pct]] [-v] image.elf\n");
+        return 2;
+    }
+    if (limits_path && !load_limits(limits_path)) {
+        fprintf(stderr, "can't read %s\n", limits_path);
+        return 2;
+    }
+
+    memset(&firmware, 0, sizeof(firmware));
+    if (elf_read_firmware(image, &firmware) != 0) {
+        fprintf(stderr, "can't read %s\n", image);
+        return 2;
+    }
+    strcpy(firmware.mmcu, "atmega328p");
+    firmware.frequency = F_CPU;
+
+    avr = avr_make_mcu_by_name(firmware.mmcu);
+    avr_init(avr);
+    avr_load_firmware(avr, &firmware);
+
+    avr_ioctl(avr, AVR_IOCTL_UART_GET_FLAGS('0'), &flags);
+    flags &= ~AVR_UART_FLAG_STDIO;
+    avr_ioctl(avr, AVR_IOCTL_UART_SET_FLAGS('0'), &flags);
+    avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_OUTPUT),
+                            uart_out, NULL);
+    avr_irq_register_notify(pin_irq(relay_pin), relay, NULL);
+    avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_SPI_GETIRQ(0), SPI_IRQ_OUTPUT),
+                            spi_out, NULL);
+    avr_irq_register_notify(pin_irq(load_pin), load, NULL);
+    for (unsigned i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++) {
+        avr_raise_irq(pin_irq(inputs[i]), 1);
+    }
+
+    if (!run()) {
+        return 1;
+    }
+    if (record_path && !(record = fopen(record_path, "w"))) {
+        fprintf(stderr, "can't write %s\n", record_path);
+        return 2;
+    }
+
+    for (int d = 0; d < DISPLAY_DECIMALS; d++) {
+        detent *= 10;
+    }
+    detent /= 10;
+    expect = (long long) set_ms * TICK - phase + edge;
+
+    printf("%s at %lu Hz, %d detents, %lu ms exposure\n", image, (unsigned long) F_CPU, turn,
+           (unsigned long) set_ms);
+    printf("  %-14s %12s %12s\n", "", "cycles", "limit");
+    ok &= check("turn", shown_after, shown_before + turn * detent,
+                shown_after == shown_before + turn * detent);
+    ok &= check("ticks", ticks, set_ms, ticks == set_ms);
+    ok &= check("relay", relay_off_at - relay_on_at, expect,
+                llabs((long long) (relay_off_at - relay_on_at) - expect)
+                <= (long long) (grid_max - grid_min));
+    ok &= measure("boot", ready_at, "");
+    ok &= measure("jitter", grid_max - grid_min, "");
+    ok &= measure("edge", edge, "");
+    ok &= measure("cli", cli_worst, "");
+    for (int v = 1; v < VECTORS; v++) {
+        if (isrs[v].count) {
+            snprintf(note, sizeof(note), ", %lu runs", (unsigned long) isrs[v].count);
+            ok &= measure(vector_names[v], isrs[v].worst, note);
+        }
+    }
+    if (record) {
+        fclose(record);
+        printf("limits with %u %% margin in %s\n", margin, record_path);
+    }
+
+    return ok ? 0 : 1;
+}
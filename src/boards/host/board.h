@@ -0,0 +1,34 @@
+#ifndef BOARD_HOST_H
+#define BOARD_HOST_H
+
+// Host build, see hal/host/hal_host.c. Pins are indices into the
+// emulated pin array, the display matches v1.
+
+/* Pins ------------------------------------------------------------------- */
+
+enum {
+    PIN_RELAY,
+    PIN_SENSE,
+    PIN_ROT_A,
+    PIN_ROT_B,
+    PIN_ROT_SW,
+    PIN_START,
+    PIN_TOGGLE,
+    PIN_MODE,
+    PIN_SPI_SCK,
+    PIN_SPI_MOSI,
+    PIN_SPI_SS,
+    PIN_CHANNEL_1,
+    PIN_CHANNEL_2,
+    HAL_PIN_COUNT
+};
+
+// Two extra timed outputs next to the relay, see channel.c
+#define BOARD_CHANNELS 3
+
+/* Display ---------------------------------------------------------------- */
+
+#define DISPLAY_DIGITS   4
+#define DISPLAY_DECIMALS 1
+
+#endif
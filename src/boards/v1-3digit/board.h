@@ -0,0 +1,11 @@
+#ifndef BOARD_V1_3DIGIT_H
+#define BOARD_V1_3DIGIT_H
+
+// v1 board fitted with a three digit display, everything else as v1.
+
+#include "../v1/board.h"
+
+#undef DISPLAY_DIGITS
+#define DISPLAY_DIGITS 3
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef BOARD_V1_PANEL_H
+#define BOARD_V1_PANEL_H
+
+// v1 board with a TM1637 key and display panel on two spare pins, next
+// to the MAX7219. Everything else as v1.
+
+#include "../v1/board.h"
+
+#define PIN_TM1637_CLK C, 1
+#define PIN_TM1637_DIO C, 2  // open drain, pulled up on the panel
+
+// Event for each panel key, by TM1637_ScanCodeToKey() number: 1-8 are
+// K1 with SG1-SG8, 9-16 K2 with SG1-SG8. Unlisted keys do nothing.
+#define PANEL_KEYS { \
+    [1] = EV_START, \
+    [2] = EV_FOCUS, \
+    [3] = EV_ENC_CLICK, \
+    [4] = EV_ENC_CW, \
+    [5] = EV_ENC_CCW, \
+}
+
+#endif
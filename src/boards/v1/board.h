@@ -0,0 +1,45 @@
+#ifndef BOARD_V1_H
+#define BOARD_V1_H
+
+// v1 board: atmega328p at 16 MHz, MAX7219 with four digits.
+//
+// Everything that differs between boards is a compile-time constant
+// here, so unused branches drop out and pin accesses fold into single
+// instructions. The build picks the board with -Iboards/<name>.
+
+#define F_CPU 16000000UL
+
+/* Pins, <port letter>, <bit> --------------------------------------------- */
+
+#define PIN_RELAY     B, 0  // RELAY header, TRIG net
+#define PIN_SENSE     C, 0  // optional light/contact sense, active low
+#define PIN_ROT_A     D, 7
+#define PIN_ROT_B     D, 6
+#define PIN_ROT_SW    D, 5
+#define PIN_START     D, 3
+#define PIN_TOGGLE    D, 4  // SW4, focus lamp
+#define PIN_MODE      D, 2  // SW5, low in TEST, high in PRINT
+#define PIN_SPI_SCK   B, 5
+#define PIN_SPI_MOSI  B, 3
+#define PIN_SPI_SS    B, 2  // MAX7219 LOAD
+
+/* Display ---------------------------------------------------------------- */
+
+#define DISPLAY_DIGITS   4
+#define DISPLAY_DECIMALS 1  // times are shown in tenths of a second
+
+/* Timers ----------------------------------------------------------------- */
+
+#define BOARD_TICK_PRESCALER 64   // Timer1, 4 us counts
+#define BOARD_POLL_PRESCALER 256  // Timer0, 256 counts, ~244 Hz
+
+/* Clock scaling ---------------------------------------------------------- */
+
+// While idle the core runs at F_CPU / BOARD_CLOCK_SLOW_DIV through
+// CLKPR. The slow prescalers keep the 4 us tick count and the poll
+// rate as they are at full speed.
+#define BOARD_CLOCK_SLOW_DIV      8   // 2 MHz
+#define BOARD_TICK_PRESCALER_SLOW 8
+#define BOARD_POLL_PRESCALER_SLOW 64  // with 128 counts
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef BOARD_V2_H
+#define BOARD_V2_H
+
+// v2 board: STM32C031K6 on HSI48, MAX7221 with four digits. Pin map
+// from pcb-files/production/netlist.ipc.
+
+#define F_CPU 48000000UL
+
+/* Pins, <port letter>, <bit> --------------------------------------------- */
+
+#define PIN_RELAY     B, 8   // TRIG
+#define PIN_SENSE     C, 15  // spare pad, active low
+#define PIN_ROT_A     A, 1
+#define PIN_ROT_B     A, 0
+#define PIN_ROT_SW    A, 3
+#define PIN_START     B, 7   // STOP+, v2 has no separate start key
+#define PIN_TOGGLE    B, 6
+#define PIN_MODE      C, 14  // MODE_TEST, low in TEST
+#define PIN_SPI_SCK   A, 5   // AF0
+#define PIN_SPI_MOSI  A, 2   // AF0
+#define PIN_SPI_SS    A, 4   // MAX7221 ~CS
+#define PIN_UART_TX   A, 9   // AF1
+#define PIN_UART_RX   A, 10  // AF1
+
+/* Display ---------------------------------------------------------------- */
+
+#define DISPLAY_DIGITS   4
+#define DISPLAY_DECIMALS 1
+
+/* Timers ----------------------------------------------------------------- */
+
+#define BOARD_TICK_PRESCALER 192  // TIM3, 4 us counts like v1
+#define BOARD_POLL_MS        4    // TIM14
+
+#endif
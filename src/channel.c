@@ -0,0 +1,291 @@
+// Extra timed outputs, channels 1 to CHANNEL_COUNT - 1.
+//
+// Each channel waits out its delay, switches on, and switches off again
+// after its length; it can be paused and resumed in either phase. The
+// phase that is running sits on a hashed timer wheel: slot due % SLOTS,
+// a list per slot, linked both ways so adding and removing take the
+// same few steps wherever the channel is. Every tick looks at the one
+// slot the time falls in and expires whatever is due there, so a tick
+// costs the same whatever the timeouts are.
+//
+// Channels only switch in channel_tick(), which runs from the exposure
+// tick interrupt. Starts and resumes take effect on the next tick, so
+// outputs started together switch in the same pass and keep their
+// relative timing to the tick. The watchdog is kept armed while any of
+// them is on, as for the relay.
+#include "hal.h"
+#include "channel.h"
+
+#if CHANNEL_COUNT > 1
+
+#include "exposure.h"
+#include "display.h"
+#include "trace.h"
+
+#define NONE 0xFF
+
+typedef struct {
+    uint32_t due;       // tick the phase ends, the wait left while paused
+    uint32_t length;    // on time still to come after the wait
+    uint8_t state;
+    uint8_t next;
+    uint8_t prev;
+} channel_t;
+
+static channel_t channels[CHANNEL_COUNT - 1];   // channel 1 first
+static uint8_t wheel[CHANNEL_WHEEL_SLOTS];      // first in each slot
+static uint8_t outputs;                         // bit per channel that is on
+
+// Pins are port/bit pairs on the AVR, not values, hence the switch.
+#define CHANNEL_PIN(n, action) case n: action(PIN_CHANNEL_##n); break
+
+static void output(uint8_t i, uint8_t on) {
+    if (on) {
+        switch (i + 1) {
+        CHANNEL_PIN(1, hal_gpio_set);
+#if CHANNEL_COUNT > 2
+        CHANNEL_PIN(2, hal_gpio_set);
+#endif
+#if CHANNEL_COUNT > 3
+        CHANNEL_PIN(3, hal_gpio_set);
+#endif
+        }
+    } else {
+        switch (i + 1) {
+        CHANNEL_PIN(1, hal_gpio_clear);
+#if CHANNEL_COUNT > 2
+        CHANNEL_PIN(2, hal_gpio_clear);
+#endif
+#if CHANNEL_COUNT > 3
+        CHANNEL_PIN(3, hal_gpio_clear);
+#endif
+        }
+    }
+
+    display_edge();
+    if (on) {
+        outputs |= 1 << i;
+    } else {
+        outputs &= ~(1 << i);
+    }
+    TRACE(TR_RELAY, (i + 1) << 1 | on);
+}
+
+// Outputs off, called by exposure_init() before the tick starts.
+void channel_init(void) {
+    for (uint8_t s = 0; s < CHANNEL_WHEEL_SLOTS; s++) {
+        wheel[s] = NONE;
+    }
+    for (uint8_t i = 0; i < CHANNEL_COUNT - 1; i++) {
+        output(i, 0);
+        switch (i + 1) {
+        CHANNEL_PIN(1, hal_gpio_output);
+#if CHANNEL_COUNT > 2
+        CHANNEL_PIN(2, hal_gpio_output);
+#endif
+#if CHANNEL_COUNT > 3
+        CHANNEL_PIN(3, hal_gpio_output);
+#endif
+        }
+    }
+}
+
+// Due in ms ticks from now, at least one.
+static void link(uint8_t i, uint32_t now, uint32_t ms) {
+    channel_t *c = &channels[i];
+    uint8_t *slot;
+
+    c->due = now + ms;
+    slot = &wheel[c->due & (CHANNEL_WHEEL_SLOTS - 1)];
+    c->prev = NONE;
+    c->next = *slot;
+    if (*slot != NONE) {
+        channels[*slot].prev = i;
+    }
+    *slot = i;
+}
+
+static void unlink(uint8_t i) {
+    channel_t *c = &channels[i];
+
+    if (c->prev != NONE) {
+        channels[c->prev].next = c->next;
+    } else {
+        wheel[c->due & (CHANNEL_WHEEL_SLOTS - 1)] = c->next;
+    }
+    if (c->next != NONE) {
+        channels[c->next].prev = c->prev;
+    }
+}
+
+// Output on delay_ms after the next tick, off ms after that. A
+// running channel starts over.
+void channel_start(uint8_t ch, uint32_t delay_ms, uint32_t ms) {
+    uint8_t i = ch - 1;
+
+    if (ch == 0 || ch >= CHANNEL_COUNT || ms == 0) {
+        return;
+    }
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        channel_stop(ch);
+        channels[i].length = ms;
+        channels[i].state = CH_WAITING;
+        link(i, timebase_millis(), delay_ms + 1);
+    }
+}
+
+void channel_pause(uint8_t ch) {
+    uint8_t i = ch - 1;
+    channel_t *c = &channels[i];
+
+    if (ch == 0 || ch >= CHANNEL_COUNT) {
+        return;
+    }
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (c->state == CH_ON) {
+            unlink(i);
+            c->length = c->due - timebase_millis();
+            c->due = 1; // back on with the tick after the resume
+            c->state = CH_PAUSED;
+            output(i, 0);
+            exposure_failsafe();
+        } else if (c->state == CH_WAITING) {
+            unlink(i);
+            c->due -= timebase_millis();
+            c->state = CH_PAUSED;
+        }
+    }
+}
+
+void channel_resume(uint8_t ch) {
+    uint8_t i = ch - 1;
+    channel_t *c = &channels[i];
+
+    if (ch == 0 || ch >= CHANNEL_COUNT) {
+        return;
+    }
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (c->state == CH_PAUSED) {
+            c->state = CH_WAITING;
+            link(i, timebase_millis(), c->due);
+        }
+    }
+}
+
+void channel_stop(uint8_t ch) {
+    uint8_t i = ch - 1;
+    channel_t *c = &channels[i];
+
+    if (ch == 0 || ch >= CHANNEL_COUNT) {
+        return;
+    }
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (c->state == CH_WAITING || c->state == CH_ON) {
+            unlink(i);
+        }
+        if (c->state == CH_ON) {
+            output(i, 0);
+            exposure_failsafe();
+        }
+        c->state = CH_IDLE;
+    }
+}
+
+uint8_t channel_state(uint8_t ch) {
+    if (ch == 0 || ch >= CHANNEL_COUNT) {
+        return CH_IDLE;
+    }
+
+    return channels[ch - 1].state;
+}
+
+// Time until the output goes off for good, in ms.
+uint32_t channel_remaining(uint8_t ch) {
+    uint32_t ms = 0;
+
+    if (ch == 0 || ch >= CHANNEL_COUNT) {
+        return 0;
+    }
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        channel_t *c = &channels[ch - 1];
+
+        switch (c->state) {
+        case CH_WAITING:
+            ms = c->due - timebase_millis() + c->length;
+            break;
+        case CH_ON:
+            ms = c->due - timebase_millis();
+            break;
+        case CH_PAUSED:
+            ms = c->due + c->length;
+            break;
+        }
+    }
+
+    return ms;
+}
+
+// Bit per extra channel whose output is on, channel 1 in bit 0.
+uint8_t channel_outputs(void) {
+    return outputs;
+}
+
+// 1 while any channel is waiting or on, its timing running.
+uint8_t channel_running(void) {
+    for (uint8_t i = 0; i < CHANNEL_COUNT - 1; i++) {
+        if (channels[i].state == CH_WAITING || channels[i].state == CH_ON) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+// 1 when an output switches within ms ticks of now. Looks at every
+// channel rather than the wheel, there are three at most.
+uint8_t channel_due_within(uint32_t now, uint32_t ms) {
+    for (uint8_t i = 0; i < CHANNEL_COUNT - 1; i++) {
+        channel_t *c = &channels[i];
+
+        if ((c->state == CH_WAITING || c->state == CH_ON) && c->due - now <= ms) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+// Called from the tick interrupt with the new time.
+void channel_tick(uint32_t now) {
+    uint8_t before = outputs;
+    uint8_t i = wheel[now & (CHANNEL_WHEEL_SLOTS - 1)];
+
+    while (i != NONE) {
+        channel_t *c = &channels[i];
+        uint8_t next = c->next;
+
+        if (c->due == now) {
+            unlink(i);
+            if (c->state == CH_WAITING) {
+                output(i, 1);
+                c->state = CH_ON;
+                link(i, now, c->length);
+            } else {
+                output(i, 0);
+                c->state = CH_IDLE;
+            }
+        }
+        i = next;
+    }
+
+    if (outputs != before) {
+        exposure_failsafe();
+    }
+}
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef CHANNEL_H
+#define CHANNEL_H
+
+#include "hal.h"
+
+// Timed outputs next to the exposure relay. Channel 0 is the relay and
+// belongs to the exposure engine. Boards with more outputs set
+// BOARD_CHANNELS and PIN_CHANNEL_1 up, those run off a timer wheel on
+// the exposure tick, see channel.c. With one channel all of this
+// compiles away.
+#ifndef BOARD_CHANNELS
+#define BOARD_CHANNELS 1
+#endif
+#define CHANNEL_COUNT BOARD_CHANNELS
+
+_Static_assert(CHANNEL_COUNT >= 1 && CHANNEL_COUNT <= 4, "channel.c drives up to three extra outputs");
+
+// Wheel slots, a power of two. Timeouts longer than this many ms go
+// round the wheel more than once, which costs one compare per turn.
+#define CHANNEL_WHEEL_SLOTS 64
+
+_Static_assert((CHANNEL_WHEEL_SLOTS & (CHANNEL_WHEEL_SLOTS - 1)) == 0, "wheel slots must be a power of two");
+
+enum {
+    CH_IDLE = 0,
+    CH_WAITING,     // counting down to switching on
+    CH_ON,
+    CH_PAUSED,
+};
+
+#if CHANNEL_COUNT > 1
+
+void channel_init(void);
+void channel_start(uint8_t ch, uint32_t delay_ms, uint32_t ms);
+void channel_pause(uint8_t ch);
+void channel_resume(uint8_t ch);
+void channel_stop(uint8_t ch);
+uint8_t channel_state(uint8_t ch);
+uint32_t channel_remaining(uint8_t ch);
+uint8_t channel_outputs(void);
+uint8_t channel_running(void);
+uint8_t channel_due_within(uint32_t now, uint32_t ms);
+void channel_tick(uint32_t now);
+
+#else
+
+static inline void channel_init(void) {
+}
+
+static inline uint8_t channel_outputs(void) {
+    return 0;
+}
+
+static inline uint8_t channel_running(void) {
+    return 0;
+}
+
+static inline uint8_t channel_due_within(uint32_t now, uint32_t ms) {
+    (void) now;
+    (void) ms;
+    return 0;
+}
+
+static inline void channel_tick(uint32_t now) {
+    (void) now;
+}
+
+#endif
+
+#endif
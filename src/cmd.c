@@ -0,0 +1,398 @@
+// Line based command interface on the UART.
+//
+// A line is a command name and optional decimal arguments separated
+// by spaces. Lines are read from the receive buffer without blocking,
+// so cmd_poll() can sit in the main loop next to the event dispatch.
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hal.h"
+#include "cmd.h"
+#include "uart.h"
+#include "exposure.h"
+#include "ui.h"
+#include "trace.h"
+#include "stack.h"
+#include "fmt.h"
+#include "power.h"
+#include "journal.h"
+#include "rotary.h"
+#include "channel.h"
+#include "display.h"
+#include "paper.h"
+#include "session.h"
+
+typedef struct {
+    char name[8];
+    void (*handler)(char *args);
+} cmd_t;
+
+static char cmd_line[CMD_LINE_SIZE];
+static uint8_t cmd_length;
+
+static uint32_t sync_host_first;
+static uint32_t sync_local_first;
+static uint32_t sync_host_last;
+static uint32_t sync_local_last;
+static uint8_t sync_samples;
+
+// lat            print the relay latencies
+// lat <on> <off> set them, in us
+static void cmd_latency(char *args) {
+    if (*args) {
+        char *end;
+        uint16_t on_us = strtoul(args, &end, 10);
+        uint16_t off_us = strtoul(end, NULL, 10);
+
+        exposure_set_latency(on_us, off_us);
+    }
+
+    put_str_P(PSTR("lat on "));
+    put_u16(exposure_get_on_latency());
+    put_str_P(PSTR(" off "));
+    put_u16(exposure_get_off_latency());
+    put_str_P(PSTR(" comp "));
+    put_i32(exposure_get_compensation());
+    put_char('\n');
+}
+
+// cal            measure the relay latencies through the sense input
+static void cmd_calibrate(char *args) {
+    if (ui_get_state() != UI_IDLE) {
+        put_str_P(PSTR("cal: busy\n"));
+        return;
+    }
+
+    if (!exposure_calibrate()) {
+        put_str_P(PSTR("cal: no sense\n"));
+        return;
+    }
+
+    cmd_latency("");
+}
+
+// drift          print the crystal correction
+// drift <ppb>    set it, positive when the crystal runs fast
+static void cmd_drift(char *args) {
+    if (*args) {
+        timebase_set_drift(strtol(args, NULL, 10));
+    }
+
+    put_str_P(PSTR("drift "));
+    put_i32(timebase_get_drift());
+    put_str_P(PSTR(" ppb\n"));
+}
+
+// Drift left over after the current correction, measured between
+// the first and the last sync sample. The ppb are divided out a
+// decimal digit at a time in 32 bits, 64 bit division would pull in
+// the libgcc routines for this alone. Spans over UINT32_MAX / 10 us
+// are halved first, which costs a few ppb at most.
+static int32_t sync_residual(void) {
+    int32_t host_us = sync_host_last - sync_host_first;
+    int32_t local_us = (sync_local_last - sync_local_first) * (1000 / TIMEBASE_COUNTS_PER_MS);
+    int32_t diff = local_us - host_us;
+    uint32_t span = host_us;
+    uint32_t rest = diff < 0 ? -(uint32_t) diff : (uint32_t) diff;
+    uint32_t ppb;
+
+    if (host_us <= 0) {
+        return 0;
+    }
+
+    while (span > UINT32_MAX / 10) {
+        span >>= 1;
+        rest >>= 1;
+    }
+    ppb = rest / span;
+    rest %= span;
+    for (uint8_t i = 0; i < 9; i++) {
+        rest *= 10;
+        ppb = ppb * 10 + rest / span;
+        rest %= span;
+    }
+
+    return diff < 0 ? -(int32_t) ppb : (int32_t) ppb;
+}
+
+// sync <host_us> timestamp sample from tools/timecal.py, the local
+//                time is the stamp of the line's '\n'
+// sync           add the measured drift to the correction and save it
+static void cmd_sync(char *args) {
+    uint32_t local = uart_line_stamp();
+
+    if (!*args) {
+        if (sync_samples > 1) {
+            timebase_set_drift(timebase_get_drift() + sync_residual());
+        }
+        sync_samples = 0;
+        cmd_drift("");
+        return;
+    }
+
+    sync_host_last = strtoul(args, NULL, 10);
+    sync_local_last = local;
+    if (sync_samples == 0) {
+        sync_host_first = sync_host_last;
+        sync_local_first = local;
+    }
+    if (sync_samples < UINT8_MAX) {
+        sync_samples++;
+    }
+
+    put_str_P(PSTR("sync "));
+    put_u16(sync_samples);
+    put_char(' ');
+    put_i32(sync_residual());
+    put_char('\n');
+}
+
+// mem            static RAM, free RAM now and the stack high-water mark
+static void cmd_memory(char *args) {
+    put_str_P(PSTR("mem static "));
+    put_u16(stack_static());
+    put_str_P(PSTR(" free "));
+    put_u16(stack_free());
+    put_str_P(PSTR(" unused "));
+    put_u16(stack_unused());
+    put_char('\n');
+}
+
+// clk            clock scaling: current clock, switches to the slow
+//                clock, time spent slow of the time since reset, and
+//                the longest switch back to full speed
+static void cmd_clock(char *args) {
+    put_str_P(power_is_slow() ? PSTR("clk slow") : PSTR("clk fast"));
+    put_str_P(PSTR(" switches "));
+    put_u16(power_get_switches());
+    put_str_P(PSTR(" slow "));
+    put_fixed(power_get_slow_ms(), 3);
+    put_str_P(PSTR(" of "));
+    put_fixed(timebase_millis(), 3);
+    put_str_P(PSTR(" s wake "));
+    put_u16(power_get_wake_worst() * (1000 / TIMEBASE_COUNTS_PER_MS));
+    put_str_P(PSTR(" us\n"));
+}
+
+// journal        binary dump of the exposure journal, see tools/journal.py
+static void cmd_journal(char *args) {
+    journal_dump();
+}
+
+// wdt            watchdog timeout and main loop allowance, in ms
+// wdt hang       arm, then hang with interrupts off, as a stuck ISR would
+// wdt loop       arm, then hang the main loop, interrupts keep running
+static void cmd_watchdog(char *args) {
+#if WDT_TEST
+    if (strcmp_P(args, PSTR("hang")) == 0) {
+        exposure_arm();
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            for (;;);
+        }
+    } else if (strcmp_P(args, PSTR("loop")) == 0) {
+        exposure_arm();
+        for (;;) {
+            hal_idle();
+        }
+    }
+#endif
+
+    put_str_P(PSTR("wdt "));
+    put_u16(HAL_WATCHDOG_MS);
+    put_char(' ');
+    put_u16(EXPOSURE_ALIVE_MS);
+    put_char('\n');
+}
+
+// disp                 display level of each UI state, 16 is off
+// disp <state> <level> set and save one, states as in "State: "
+static void cmd_display(char *args) {
+    if (*args) {
+        char *end;
+        uint8_t state = strtoul(args, &end, 10);
+
+        display_set_level(state, strtoul(end, NULL, 10));
+    }
+
+    put_str_P(PSTR("disp"));
+    for (uint8_t state = 0; state < UI_STATE_COUNT; state++) {
+        put_char(' ');
+        put_u16(display_get_level(state));
+    }
+    put_char('\n');
+}
+
+// paper          paper profiles, the selected one marked, and what
+//                each makes of 10 s; select them in the UI
+static void cmd_paper(char *args) {
+    for (uint8_t p = 0; p < PAPER_COUNT; p++) {
+        put_str_P(PSTR("paper "));
+        put_u16(p);
+        put_char(' ');
+        put_str_P(paper_name(p));
+        put_char(' ');
+        put_fixed(paper_correct(p, 10000), 3);
+        put_str_P(p == paper_get() ? PSTR(" *\n") : PSTR("\n"));
+    }
+}
+
+// load           upload a session at SESSION_BAUD, see tools/session.py
+// load <baud>    at another rate
+static void cmd_load(char *args) {
+    uint32_t baud = *args ? strtoul(args, NULL, 10) : SESSION_BAUD;
+
+    if (ui_get_state() != UI_IDLE || baud == 0) {
+        put_str_P(PSTR("load: busy\n"));
+        return;
+    }
+
+    session_load(baud);
+}
+
+// prog           current program and programs in the session
+// prog <n>       switch to program n of the session
+static void cmd_program(char *args) {
+    if (*args && !ui_select_program(strtoul(args, NULL, 10))) {
+        put_str_P(PSTR("prog: no\n"));
+        return;
+    }
+
+    put_str_P(PSTR("prog "));
+    put_u16(ui_get_program());
+    put_str_P(PSTR(" of "));
+    put_u16(session_count());
+    put_char('\n');
+}
+
+#if CHANNEL_COUNT > 1
+// ch                       state and ms left of each extra channel
+// ch <n> <delay> <ms>      output n on after delay ms, for ms
+// ch <n> pause|resume|stop
+static void cmd_channel(char *args) {
+    static const char states[] PROGMEM = "idle\0wait\0on\0\0\0paused";
+
+    if (*args) {
+        char *end;
+        uint8_t ch = strtoul(args, &end, 10);
+
+        while (*end == ' ') {
+            end++;
+        }
+        if (strcmp_P(end, PSTR("pause")) == 0) {
+            channel_pause(ch);
+        } else if (strcmp_P(end, PSTR("resume")) == 0) {
+            channel_resume(ch);
+        } else if (strcmp_P(end, PSTR("stop")) == 0) {
+            channel_stop(ch);
+        } else {
+            uint32_t delay_ms = strtoul(end, &end, 10);
+
+            channel_start(ch, delay_ms, strtoul(end, NULL, 10));
+        }
+    }
+
+    for (uint8_t ch = 1; ch < CHANNEL_COUNT; ch++) {
+        put_str_P(PSTR("ch "));
+        put_u16(ch);
+        put_char(' ');
+        put_str_P(states + 5 * channel_state(ch));
+        put_char(' ');
+        put_u32(channel_remaining(ch));
+        put_char('\n');
+    }
+}
+#endif
+
+#if ROTARY_CAPTURE
+// enc            record the encoder lines for the next few seconds
+// enc dump       binary dump of the recording, see tools/encoder.py
+static void cmd_encoder(char *args) {
+    if (rotary_capture_busy()) {
+        put_str_P(PSTR("enc: busy\n"));
+        return;
+    }
+
+    if (strcmp_P(args, PSTR("dump")) == 0) {
+        rotary_capture_dump();
+        return;
+    }
+
+    rotary_capture_start();
+    put_str_P(PSTR("enc "));
+    put_u16(ROTARY_CAPTURE * 4);
+    put_str_P(PSTR(" samples\n"));
+}
+#endif
+
+#if TRACE_ENABLE
+// trace          binary dump of the event trace, see tools/tracedump.py
+static void cmd_trace(char *args) {
+    trace_dump();
+}
+#endif
+
+static const cmd_t cmd_table[] PROGMEM = {
+    { "lat", cmd_latency },
+    { "cal", cmd_calibrate },
+    { "drift", cmd_drift },
+    { "sync", cmd_sync },
+    { "mem", cmd_memory },
+    { "clk", cmd_clock },
+    { "journal", cmd_journal },
+    { "wdt", cmd_watchdog },
+    { "disp", cmd_display },
+    { "paper", cmd_paper },
+    { "load", cmd_load },
+    { "prog", cmd_program },
+#if CHANNEL_COUNT > 1
+    { "ch", cmd_channel },
+#endif
+#if ROTARY_CAPTURE
+    { "enc", cmd_encoder },
+#endif
+#if TRACE_ENABLE
+    { "trace", cmd_trace },
+#endif
+};
+
+static void cmd_execute(char *line) {
+    char *args = strchr(line, ' ');
+
+    if (args) {
+        *args++ = '\0';
+    } else {
+        args = line + strlen(line);
+    }
+
+    for (uint8_t i = 0; i < sizeof(cmd_table) / sizeof(cmd_table[0]); i++) {
+        if (strcmp_P(line, cmd_table[i].name) == 0) {
+            ((void (*)(char *)) pgm_read_ptr(&cmd_table[i].handler))(args);
+            return;
+        }
+    }
+
+    if (*line) {
+        put_str_P(PSTR("?\n"));
+    }
+}
+
+void cmd_poll(void) {
+    if (session_loading()) {
+        session_poll();
+        return;
+    }
+
+    while (uart_available() && !session_loading()) {
+        char c = uart_getchar(NULL);
+
+        if (c == '\r' || c == '\n') {
+            cmd_line[cmd_length] = '\0';
+            cmd_length = 0;
+            cmd_execute(cmd_line);
+        } else if (cmd_length < CMD_LINE_SIZE - 1) {
+            cmd_line[cmd_length++] = c;
+        }
+    }
+}
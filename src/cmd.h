@@ -0,0 +1,9 @@
+#ifndef CMD_H
+#define CMD_H
+
+// Longest command line accepted over the UART, including arguments
+#define CMD_LINE_SIZE 32
+
+void cmd_poll(void);
+
+#endif
@@ -11,14 +11,9 @@
  * $Id$
  */
 
-/* CPU frequency */
-#define F_CPU 16000000UL
-
 /* UART baud rate */
 #define BAUD  9600UL
 
-#define MYUBRR F_CPU / 16 / BAUD - 1
-
 /* Whether to read the busy flag, or fall back to
    worst-time delays. */
 #define USE_BUSY_BIT 1
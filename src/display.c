@@ -0,0 +1,144 @@
+// Display brightness policy.
+//
+// Each UI state has a MAX7219 intensity, or shutdown, kept in EEPROM
+// and set with 'disp'. By default the display goes dark while the
+// relay is on, so it neither fogs the paper nor switches segment
+// current while the lamp does, and dim while paused. display_cue()
+// brings it up briefly, as at the end of an exposure.
+//
+// Changes are only asked for by the main loop and committed by
+// display_poll(), when the exposure tick has opened the window for
+// it: no relay or channel edge in the last DISPLAY_SETTLE_MS and none
+// due within that time either, from the end of the running exposure or
+// a channel's delay or length running out. The
+// tick does the timing in a few instructions and never touches the
+// SPI bus, so the relay edges, which also happen in the tick, keep
+// their timing. The one exception is the way into an exposure: the
+// RUNNING level is written before the relay goes on, so a dark
+// display is dark from the first ms. Digit updates are dropped while
+// the display is shut down and the last number is redrawn when it
+// comes back.
+#include "hal.h"
+#include "display.h"
+#include "max7219.h"
+#include "ui.h"
+#include "trace.h"
+
+#define DISPLAY_DEFAULTS {            \
+    [UI_IDLE]         = 4,            \
+    [UI_FOCUS]        = 4,            \
+    [UI_SET_TIME]     = 4,            \
+    [UI_RUNNING]      = DISPLAY_OFF,  \
+    [UI_PAUSED]       = 1,            \
+    [UI_TEST_STRIP]   = 4,            \
+    [UI_PROGRAM_EDIT] = 4,            \
+    [UI_PAPER]        = 4,            \
+}
+
+static const uint8_t display_defaults[UI_STATE_COUNT] PROGMEM = DISPLAY_DEFAULTS;
+static uint8_t EEMEM display_ee[UI_STATE_COUNT] = DISPLAY_DEFAULTS;
+
+static uint8_t levels[UI_STATE_COUNT];
+static uint8_t target;                  // level of the current state
+static uint8_t shown = DISPLAY_OFF;     // level the chip has, off at power up
+static volatile uint8_t quiet_ms;       // since the last edge, saturates
+static volatile uint8_t cue_ms;
+static volatile uint8_t window;         // a change may go out now
+
+_Static_assert(DISPLAY_SETTLE_MS < 255 && DISPLAY_CUE_MS < 256, "tick counters are 8 bit");
+
+// Coming out of shutdown the digits are caught up first, so the
+// first lit frame is the current one.
+static void write_level(uint8_t level) {
+    uint8_t was_off = shown == DISPLAY_OFF;
+
+    shown = level;
+    if (level == DISPLAY_OFF) {
+        MAX7219_writeData(MAX7219_MODE_POWER, OFF);
+    } else {
+        MAX7219_writeData(MAX7219_MODE_INTENSITY, level);
+        if (was_off) {
+            MAX7219_redraw();
+            MAX7219_writeData(MAX7219_MODE_POWER, ON);
+        }
+    }
+    TRACE(TR_DISPLAY_LEVEL, level);
+}
+
+// Loads the levels and lights the display at the level of the UI's
+// first state. Nothing is switching yet, so this writes straight away.
+void display_init(uint8_t state) {
+    for (uint8_t i = 0; i < UI_STATE_COUNT; i++) {
+        levels[i] = hal_store_read_byte(&display_ee[i]);
+        if (levels[i] > DISPLAY_OFF) {
+            levels[i] = pgm_read_byte(&display_defaults[i]); // blank EEPROM
+        }
+    }
+
+    target = levels[state];
+    write_level(target);
+}
+
+void display_set_state(uint8_t state) {
+    target = levels[state];
+}
+
+void display_cue(void) {
+    cue_ms = DISPLAY_CUE_MS;
+}
+
+// Commits a pending change if the tick says it may.
+void display_poll(void) {
+    uint8_t level = cue_ms ? DISPLAY_CUE_LEVEL : target;
+
+    if (level != shown && window) {
+        write_level(level);
+    }
+}
+
+// The relay is about to go on for an exposure, called from the main
+// loop. Waiting for the window would leave the display lit for the
+// first DISPLAY_SETTLE_MS of it.
+void display_exposing(void) {
+    target = levels[UI_RUNNING];
+    cue_ms = 0;
+    if (target != shown) {
+        write_level(target);
+    }
+}
+
+uint8_t display_is_off(void) {
+    return shown == DISPLAY_OFF;
+}
+
+uint8_t display_get_level(uint8_t state) {
+    return levels[state];
+}
+
+// Saved, and in effect from the next change of state.
+void display_set_level(uint8_t state, uint8_t level) {
+    if (state >= UI_STATE_COUNT || level > DISPLAY_OFF) {
+        return;
+    }
+
+    levels[state] = level;
+    hal_store_update_byte(&display_ee[state], level);
+}
+
+// A relay or channel output just switched.
+void display_edge(void) {
+    quiet_ms = 0;
+    window = 0;
+}
+
+// Called from the 1 ms tick, edge_due when an output switches within
+// DISPLAY_SETTLE_MS.
+void display_tick(uint8_t edge_due) {
+    if (quiet_ms < DISPLAY_SETTLE_MS) {
+        quiet_ms++;
+    }
+    if (cue_ms) {
+        cue_ms--;
+    }
+    window = quiet_ms >= DISPLAY_SETTLE_MS && !edge_due;
+}
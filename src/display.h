@@ -0,0 +1,31 @@
+#ifndef DISPLAY_H
+#define DISPLAY_H
+
+#include <stdint.h>
+
+// MAX7219 brightness per UI state, see display.c. Levels are the
+// intensity register, 0 to 15, or DISPLAY_OFF for shutdown.
+#define DISPLAY_OFF 16
+
+// Relay edges are kept this far from a brightness change, in ms
+#define DISPLAY_SETTLE_MS 20
+
+// A cue shows the display at DISPLAY_CUE_LEVEL for this long, in ms
+#define DISPLAY_CUE_MS    250
+#define DISPLAY_CUE_LEVEL 15
+
+void display_init(uint8_t state);
+void display_set_state(uint8_t state);
+void display_cue(void);
+void display_poll(void);
+void display_exposing(void);
+uint8_t display_is_off(void);
+
+uint8_t display_get_level(uint8_t state);
+void display_set_level(uint8_t state, uint8_t level);
+
+// From the tick interrupt or with interrupts off
+void display_edge(void);
+void display_tick(uint8_t edge_due);
+
+#endif
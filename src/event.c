@@ -0,0 +1,42 @@
+#include "hal.h"
+
+#include "event.h"
+
+static volatile uint8_t event_queue[EVENT_QUEUE_SIZE];
+static volatile uint8_t event_head;
+static volatile uint8_t event_tail;
+static volatile uint8_t event_dropped;
+
+// Producers are the ISRs and the UI actions themselves, so the
+// head has to be claimed atomically. A full queue drops the event
+// and counts it rather than blocking.
+void event_put(uint8_t event) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        uint8_t next = (event_head + 1) & (EVENT_QUEUE_SIZE - 1);
+
+        if (next == event_tail) {
+            event_dropped++;
+        } else {
+            event_queue[event_head] = event;
+            event_head = next;
+        }
+    }
+}
+
+// Single consumer (the main loop), the tail is only written here.
+uint8_t event_get(void) {
+    uint8_t tail = event_tail;
+
+    if (tail == event_head) {
+        return EV_NONE;
+    }
+
+    uint8_t event = event_queue[tail];
+    event_tail = (tail + 1) & (EVENT_QUEUE_SIZE - 1);
+
+    return event;
+}
+
+uint8_t event_get_dropped(void) {
+    return event_dropped;
+}
@@ -0,0 +1,30 @@
+#ifndef EVENT_H
+#define EVENT_H
+
+#include <stdint.h>
+
+// Events posted by the ISRs and consumed by the UI state machine.
+// The values index the transition table in ui.c, keep them dense.
+enum {
+    EV_NONE = 0,
+    EV_ENC_CW,      // encoder turned one detent clockwise
+    EV_ENC_CCW,     // encoder turned one detent counter-clockwise
+    EV_ENC_CLICK,   // encoder push button
+    EV_START,       // start/stop button on PD3
+    EV_FOCUS,       // TOGGLE button, focus lamp on/off
+    EV_TICK,        // 100 ms tick from the exposure timebase
+    EV_DONE,        // exposure finished, relay is already off
+    EV_TIMEOUT,     // focus lamp timed out
+    EV_MODE_PRINT,  // mode switch moved to PRINT
+    EV_MODE_TEST,   // mode switch moved to TEST
+    EV_COUNT
+};
+
+// Must be a power of two.
+#define EVENT_QUEUE_SIZE 16
+
+void event_put(uint8_t event);
+uint8_t event_get(void);
+uint8_t event_get_dropped(void);
+
+#endif
@@ -0,0 +1,419 @@
+// Exposure engine: a 1 ms timer tick that owns the relay.
+//
+// The countdown and the relay edge both happen in the tick interrupt so the
+// exposure length does not depend on how busy the main loop is.
+//
+// The relay and lamp take a while to respond to each edge. With
+// on and off latencies L_on and L_off, driving the relay for T
+// gives T - L_on + L_off of light, so the drive time is stretched
+// by L_on - L_off (rounded to the tick). Both edges then land early
+// by their calibrated amount and the light time matches the set time.
+//
+// The crystal error is corrected in the same interrupt: the measured drift
+// in ppb is accumulated every tick and each time it adds up to a whole
+// timer count, that tick is made one count longer or shorter.
+//
+// Failsafe: the watchdog is armed whenever the relay or one of the
+// extra channels (channel.c) is driven and
+// only the tick feeds it, as long as the main loop has called
+// exposure_alive() within EXPOSURE_ALIVE_MS. The relay pin stops
+// driving the moment the reset starts, so from a hang to the relay
+// dropping out takes at most
+//
+//   tick stopped (interrupts off, stuck ISR)  HAL_WATCHDOG_MS + 1
+//   main loop stopped, tick still running     EXPOSURE_ALIVE_MS + HAL_WATCHDOG_MS
+//
+// plus the relay's own release time. That is 61 and 1060 ms on the
+// atmega328p, where the watchdog oscillator is untrimmed and may be a
+// few ten percent off. 'wdt hang' and 'wdt loop' stage both cases.
+//
+// The countdown lives in RAM the C runtime leaves alone. After a
+// watchdog reset exposure_init() keeps what was left of an exposure
+// and exposure_interrupted() reports it, the relay stays off until
+// exposure_resume().
+#include "hal.h"
+#include "exposure.h"
+#include "channel.h"
+#include "display.h"
+#include "event.h"
+#include "trace.h"
+
+static volatile uint32_t exposure_ms HAL_NOINIT;
+static volatile uint32_t exposure_driven_ms HAL_NOINIT;
+static uint32_t exposure_set_ms HAL_NOINIT;
+static uint16_t exposure_magic HAL_NOINIT;   // the three above are ours
+static uint8_t exposure_restored;
+static uint8_t relay_driven;
+static uint8_t watchdog_armed;
+static volatile uint16_t alive_ms;           // since the main loop checked in
+static int16_t exposure_comp_ms;
+static uint16_t latency_on_us;
+static uint16_t latency_off_us;
+static uint16_t EEMEM latency_on_ee;
+static uint16_t EEMEM latency_off_ee;
+static volatile uint8_t exposure_running;
+volatile uint32_t timebase_ms;
+static uint8_t tick_divider;
+static int32_t drift_ppb;
+static int32_t drift_acc;
+static int32_t EEMEM drift_ee;
+
+// Arms the watchdog while any output is driven, disarms it once none
+// is. Called after every change of the relay or a channel output.
+void exposure_failsafe(void) {
+    uint8_t driven = relay_driven || channel_outputs();
+
+    if (driven && !watchdog_armed) {
+        exposure_alive();
+        watchdog_armed = 1;
+        hal_watchdog_start();
+    } else if (!driven && watchdog_armed) {
+        watchdog_armed = 0;
+        hal_watchdog_stop();
+    }
+}
+
+#if WDT_TEST
+// Arms the watchdog with no output driven, so the main loop allowance
+// runs as it would during an exposure.
+void exposure_arm(void) {
+    exposure_alive();
+    watchdog_armed = 1;
+    hal_watchdog_start();
+}
+#endif
+
+void relay_on(void) {
+    relay_driven = 1;
+    exposure_failsafe();
+    hal_gpio_set(PIN_RELAY);
+    display_edge();
+    TRACE(TR_RELAY, 1);
+}
+
+void relay_off(void) {
+    hal_gpio_clear(PIN_RELAY);
+    relay_driven = 0;
+    exposure_failsafe();
+    display_edge();
+    TRACE(TR_RELAY, 0);
+}
+
+static void update_compensation(void) {
+    int32_t diff_us = (int32_t) latency_on_us - latency_off_us;
+
+    exposure_comp_ms = (diff_us + (diff_us < 0 ? -500 : 500)) / 1000;
+}
+
+void exposure_init(void) {
+    relay_off();
+    hal_gpio_output(PIN_RELAY);
+    hal_gpio_input_pullup(PIN_SENSE);
+    channel_init();
+
+    latency_on_us = hal_store_read_word(&latency_on_ee);
+    latency_off_us = hal_store_read_word(&latency_off_ee);
+    if (latency_on_us == 0xFFFF || latency_off_us == 0xFFFF) {
+        latency_on_us = latency_off_us = 0; // blank EEPROM
+    }
+    update_compensation();
+
+    drift_ppb = hal_store_read_dword((const uint32_t *) &drift_ee);
+    if (drift_ppb == -1) {
+        drift_ppb = 0; // blank EEPROM
+    }
+
+    if (hal_watchdog_fired() && exposure_magic == EXPOSURE_MAGIC && exposure_ms) {
+        exposure_restored = 1;
+    } else {
+        exposure_ms = 0;
+        exposure_driven_ms = 0;
+        exposure_set_ms = 0;
+        exposure_magic = EXPOSURE_MAGIC;
+    }
+
+    hal_tick_init();
+}
+
+// Drive time for ms of light, never less than one tick.
+static uint32_t compensate(uint32_t ms) {
+    if (exposure_comp_ms < 0 && ms <= (uint32_t) -exposure_comp_ms) {
+        return 1;
+    }
+
+    return ms + exposure_comp_ms;
+}
+
+void exposure_start(uint32_t ms) {
+    exposure_set_ms = ms;
+
+    if (ms == 0) {
+        exposure_driven_ms = 0; // not running, the tick leaves it alone
+        event_put(EV_DONE);
+        return;
+    }
+
+    ms = compensate(ms);
+    exposure_restored = 0;
+    display_exposing();
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        exposure_ms = ms;
+        exposure_driven_ms = 0;
+        exposure_running = 1;
+        relay_on();
+    }
+}
+
+void exposure_pause(void) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        exposure_running = 0;
+        relay_off();
+    }
+}
+
+// The pause cost another pair of relay edges, compensate for them too.
+void exposure_resume(void) {
+    if (exposure_ms) {
+        display_exposing();
+    }
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (exposure_ms) {
+            exposure_ms = compensate(exposure_ms);
+            exposure_running = 1;
+            relay_on();
+        }
+    }
+}
+
+void exposure_abort(void) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        exposure_running = 0;
+        exposure_ms = 0;
+        relay_off();
+    }
+    exposure_restored = 0;
+}
+
+// 1 when a watchdog reset cut the last exposure short, paused with
+// exposure_remaining() to go. Cleared by the next start or abort.
+uint8_t exposure_interrupted(void) {
+    return exposure_restored;
+}
+
+// Main loop check-in, keeps the tick feeding the watchdog.
+void exposure_alive(void) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        alive_ms = 0;
+    }
+}
+
+uint32_t exposure_remaining(void) {
+    uint32_t ms;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        ms = exposure_ms;
+    }
+
+    return ms;
+}
+
+uint8_t exposure_is_running(void) {
+    return exposure_running;
+}
+
+// Light time asked for by the last exposure_start().
+uint32_t exposure_get_set(void) {
+    return exposure_set_ms;
+}
+
+// Ticks the relay was driven for by the last exposure_start(), pauses
+// excluded and compensation included.
+uint32_t exposure_get_driven(void) {
+    uint32_t ms;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        ms = exposure_driven_ms;
+    }
+
+    return ms;
+}
+
+void exposure_set_latency(uint16_t on_us, uint16_t off_us) {
+    latency_on_us = on_us;
+    latency_off_us = off_us;
+    update_compensation();
+
+    hal_store_update_word(&latency_on_ee, on_us);
+    hal_store_update_word(&latency_off_ee, off_us);
+}
+
+uint16_t exposure_get_on_latency(void) {
+    return latency_on_us;
+}
+
+uint16_t exposure_get_off_latency(void) {
+    return latency_off_us;
+}
+
+// Ticks added to the drive time of every exposure and resume.
+int16_t exposure_get_compensation(void) {
+    return exposure_comp_ms;
+}
+
+// Time from now until the sense input reads level, in tick timer
+// counts, or 0 on timeout.
+static uint16_t wait_for_sense(uint8_t level) {
+    uint16_t start = timebase_now();
+    uint16_t elapsed;
+
+    do {
+        exposure_alive();
+        elapsed = timebase_now() - start;
+        if ((hal_gpio_read(PIN_SENSE) ? 0 : 1) == level) { // active low
+            return elapsed ? elapsed : 1;
+        }
+    } while (elapsed < LATENCY_TIMEOUT_MS * TIMEBASE_COUNTS_PER_MS);
+
+    return 0;
+}
+
+static void settle(void) {
+    uint16_t start = timebase_now();
+
+    while ((uint16_t) (timebase_now() - start) < LATENCY_TIMEOUT_MS * TIMEBASE_COUNTS_PER_MS) {
+        exposure_alive();
+    }
+}
+
+// Measure relay on/off latency through the sense input. Blocks with
+// the relay going on and off, checking in for the main loop meanwhile
+// but with the UI stopped: each cycle is two waits for the sense input
+// and two settles of LATENCY_TIMEOUT_MS each, so LATENCY_CYCLES * 4 *
+// LATENCY_TIMEOUT_MS (6.4 s) at worst and about half that with a sense
+// input that follows promptly. Only call it while nothing is exposing.
+// Returns 0 when the sense input never followed the relay.
+uint8_t exposure_calibrate(void) {
+    uint32_t on_total = 0;
+    uint32_t off_total = 0;
+
+    for (uint8_t i = 0; i < LATENCY_CYCLES; i++) {
+        relay_on();
+        uint16_t on = wait_for_sense(1);
+        settle(); // let the lamp warm up as it would when printing
+
+        relay_off();
+        uint16_t off = wait_for_sense(0);
+        settle();
+
+        if (!on || !off) {
+            relay_off();
+            return 0;
+        }
+
+        on_total += on;
+        off_total += off;
+    }
+
+    exposure_set_latency(on_total * (1000 / TIMEBASE_COUNTS_PER_MS) / LATENCY_CYCLES,
+                         off_total * (1000 / TIMEBASE_COUNTS_PER_MS) / LATENCY_CYCLES);
+
+    return 1;
+}
+
+// Free running time in tick timer counts, wraps every ~4.7 hours at
+// 4 us per count. Only meant for measuring intervals by subtraction.
+uint32_t timebase_stamp(void) {
+    uint32_t ms;
+    uint16_t counts;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        ms = timebase_ms;
+        counts = hal_tick_counts();
+        // Tick already elapsed but its interrupt has not run yet
+        if (hal_tick_pending() && counts < TIMEBASE_COUNTS_PER_MS / 2) {
+            ms++;
+        }
+    }
+
+    return ms * TIMEBASE_COUNTS_PER_MS + counts;
+}
+
+// Low half of timebase_stamp(), wraps every ~262 ms.
+uint16_t timebase_now(void) {
+    return timebase_stamp();
+}
+
+// Milliseconds since reset.
+uint32_t timebase_millis(void) {
+    uint32_t ms;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        ms = timebase_ms;
+    }
+
+    return ms;
+}
+
+// Crystal error in ppb, positive when the crystal runs fast.
+void timebase_set_drift(int32_t ppb) {
+    if (ppb > DRIFT_PPB_PER_COUNT) {
+        ppb = DRIFT_PPB_PER_COUNT;
+    } else if (ppb < -DRIFT_PPB_PER_COUNT) {
+        ppb = -DRIFT_PPB_PER_COUNT;
+    }
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        drift_ppb = ppb;
+        drift_acc = 0;
+    }
+
+    hal_store_update_dword((uint32_t *) &drift_ee, ppb);
+}
+
+int32_t timebase_get_drift(void) {
+    return drift_ppb;
+}
+
+// Called from the 1 ms tick interrupt.
+void exposure_tick(void) {
+    timebase_ms++;
+    channel_tick(timebase_ms);
+
+    if (!watchdog_armed) {
+        hal_watchdog_feed(); // the IWDG can't be stopped
+    } else if (alive_ms < EXPOSURE_ALIVE_MS) {
+        alive_ms++;
+        hal_watchdog_feed();
+    }
+
+    // Sets the length of the tick that is starting now.
+    drift_acc += drift_ppb;
+    if (drift_acc >= DRIFT_PPB_PER_COUNT) {
+        drift_acc -= DRIFT_PPB_PER_COUNT;
+        hal_tick_trim(1);
+    } else if (drift_acc <= -DRIFT_PPB_PER_COUNT) {
+        drift_acc += DRIFT_PPB_PER_COUNT;
+        hal_tick_trim(-1);
+    } else {
+        hal_tick_trim(0);
+    }
+
+    if (exposure_running) {
+        exposure_driven_ms++;
+        if (--exposure_ms == 0) {
+            relay_off();
+            exposure_running = 0;
+            event_put(EV_DONE);
+        }
+    }
+
+    display_tick((exposure_running && exposure_ms <= DISPLAY_SETTLE_MS)
+                 || channel_due_within(timebase_ms, DISPLAY_SETTLE_MS));
+
+    if (++tick_divider == EXPOSURE_TICK_MS) {
+        tick_divider = 0;
+        event_put(EV_TICK);
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef EXPOSURE_H
+#define EXPOSURE_H
+
+#include "hal.h"
+
+// Tick timer counts per ms, timebase_now() runs in these units
+// (4 us on the atmega328p at 16 MHz).
+#define TIMEBASE_COUNTS_PER_MS HAL_TICK_COUNTS_PER_MS
+
+// EV_TICK is posted every this many ms.
+#define EXPOSURE_TICK_MS 100
+
+// Crystal trim: one tick timer count per tick corrects this many ppb,
+// which is also the largest correction that can be applied.
+#define DRIFT_PPB_PER_COUNT ((int32_t) (1000000000L / TIMEBASE_COUNTS_PER_MS))
+
+// Longest the main loop may go without exposure_alive() while the
+// relay is driven before the watchdog is left to fire. The journal
+// dump, the longest wait on the UART, takes about 600 ms at 9600 baud.
+#define EXPOSURE_ALIVE_MS 1000
+
+// Set to 1 for 'wdt hang' and 'wdt loop', which reset the board
+#ifndef WDT_TEST
+#define WDT_TEST 0
+#endif
+
+// Marks the countdown in RAM as this firmware's after a reset
+#define EXPOSURE_MAGIC 0xE7A5
+
+// Relay latency calibration: cycles averaged, per-edge timeout
+#define LATENCY_CYCLES     8
+#define LATENCY_TIMEOUT_MS 200
+
+void exposure_init(void);
+void exposure_start(uint32_t ms);
+void exposure_pause(void);
+void exposure_resume(void);
+void exposure_abort(void);
+uint32_t exposure_remaining(void);
+uint8_t exposure_is_running(void);
+uint32_t exposure_get_set(void);
+uint32_t exposure_get_driven(void);
+uint8_t exposure_interrupted(void);
+void exposure_alive(void);
+void exposure_failsafe(void);
+#if WDT_TEST
+void exposure_arm(void);
+#endif
+
+void exposure_set_latency(uint16_t on_us, uint16_t off_us);
+uint16_t exposure_get_on_latency(void);
+uint16_t exposure_get_off_latency(void);
+int16_t exposure_get_compensation(void);
+uint8_t exposure_calibrate(void);
+
+void relay_on(void);
+void relay_off(void);
+
+uint16_t timebase_now(void);
+uint32_t timebase_stamp(void);
+uint32_t timebase_millis(void);
+
+void timebase_set_drift(int32_t ppb);
+int32_t timebase_get_drift(void);
+
+#endif
@@ -0,0 +1,100 @@
+// Decimal output without division: each digit is found by repeated
+// subtraction of its power of ten, at most nine per digit, so a full
+// 32-bit number costs a few hundred cycles instead of ten calls to
+// the 32-bit division routine that ultoa() and vfprintf() use.
+#include <stdint.h>
+#include <stdio.h>
+
+#include "fmt.h"
+#include "uart.h"
+
+static const uint32_t powers32[] PROGMEM = {
+    1000000000UL, 100000000UL, 10000000UL, 1000000UL, 100000UL,
+    10000UL, 1000UL, 100UL, 10UL, 1UL,
+};
+
+static const uint16_t powers16[] PROGMEM = {
+    10000U, 1000U, 100U, 10U, 1U,
+};
+
+#define POWERS32 (sizeof(powers32) / sizeof(powers32[0]))
+#define POWERS16 (sizeof(powers16) / sizeof(powers16[0]))
+
+void put_char(char c) {
+    uart_putchar(c, NULL);
+}
+
+void put_str(const char *s) {
+    while (*s) {
+        put_char(*s++);
+    }
+}
+
+void put_str_P(const char *s) {
+    char c;
+
+    while ((c = pgm_read_byte(s++))) {
+        put_char(c);
+    }
+}
+
+void put_u16(uint16_t value) {
+    uint8_t started = 0;
+
+    for (uint8_t i = 0; i < POWERS16; i++) {
+        uint16_t power = pgm_read_word(&powers16[i]);
+        char digit = '0';
+
+        while (value >= power) {
+            value -= power;
+            digit++;
+        }
+
+        if (digit != '0' || i == POWERS16 - 1) {
+            started = 1;
+        }
+        if (started) {
+            put_char(digit);
+        }
+    }
+}
+
+// value / 10^decimals with exactly decimals digits after the point,
+// always at least one digit before it.
+void put_fixed(uint32_t value, uint8_t decimals) {
+    uint8_t started = 0;
+
+    for (uint8_t i = 0; i < POWERS32; i++) {
+        uint32_t power = pgm_read_dword(&powers32[i]);
+        uint8_t after = POWERS32 - 1 - i; // digits to the right of this one
+        char digit = '0';
+
+        while (value >= power) {
+            value -= power;
+            digit++;
+        }
+
+        if (digit != '0' || after <= decimals) {
+            started = 1;
+        }
+        if (started) {
+            put_char(digit);
+            if (after == decimals && decimals) {
+                put_char('.');
+            }
+        }
+    }
+}
+
+void put_u32(uint32_t value) {
+    put_fixed(value, 0);
+}
+
+void put_i32(int32_t value) {
+    if (value < 0) {
+        put_char('-');
+        put_fixed(-(uint32_t) value, 0);
+    } else {
+        put_fixed(value, 0);
+    }
+}
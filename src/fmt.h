@@ -0,0 +1,22 @@
+#ifndef FMT_H
+#define FMT_H
+
+#include <stdint.h>
+#include <avr/pgmspace.h>
+
+// Small typed formatter writing straight into the UART transmit
+// buffer, in place of fprintf.
+//
+//     put_str_P(PSTR("Run: "));
+//     put_fixed(ms, 3);          // 12500 -> "12.500"
+//     put_str_P(PSTR(" s\n"));
+
+void put_char(char c);
+void put_str(const char *s);
+void put_str_P(const char *s);
+void put_u16(uint16_t value);
+void put_u32(uint32_t value);
+void put_i32(int32_t value);
+void put_fixed(uint32_t value, uint8_t decimals);
+
+#endif
@@ -0,0 +1,123 @@
+// F-stop table with dirty tracking.
+//
+// pow() only runs when the interval changes. A refresh is a handful
+// of multiplications from the base, a shift is one, so the cost of an
+// encoder event no longer depends on the table size.
+#include <math.h>
+
+#include "fstop.h"
+
+#define FSTOP_HALF (FSTOP_COUNT / 2)
+
+#define DIRTY_RATIO 0x01
+#define DIRTY_TABLE 0x02
+
+void fstop_init(fstop_t *m, double base_s, double interval) {
+    m->base_s = base_s;
+    m->interval = interval;
+    m->first = 0;
+    m->scale = 1.0;
+    m->dirty = DIRTY_RATIO | DIRTY_TABLE;
+}
+
+void fstop_set_base(fstop_t *m, double base_s) {
+    m->base_s = base_s;
+    m->dirty |= DIRTY_TABLE;
+}
+
+// Moves the base to base_s and the table with it by changing its
+// scale, which leaves a clean table clean.
+void fstop_rescale(fstop_t *m, double base_s) {
+    m->scale *= base_s / m->base_s;
+    m->base_s = base_s;
+}
+
+void fstop_set_interval(fstop_t *m, double interval) {
+    if (interval != m->interval) {
+        m->interval = interval;
+        m->dirty |= DIRTY_RATIO | DIRTY_TABLE;
+    }
+}
+
+static void refresh(fstop_t *m) {
+    double t = m->base_s;
+
+    if (m->dirty & DIRTY_RATIO) {
+        m->ratio = pow(2, m->interval);
+    }
+
+    for (uint8_t i = 0; i < FSTOP_HALF; i++) {
+        t /= m->ratio;
+    }
+
+    m->first = 0;
+    m->scale = 1.0;
+    for (uint8_t i = 0; i < FSTOP_COUNT; i++) {
+        m->table[i] = t;
+        t *= m->ratio;
+    }
+
+    m->dirty = 0;
+}
+
+static uint8_t ring(const fstop_t *m, uint8_t i) {
+    i += m->first;
+
+    return i < FSTOP_COUNT ? i : i - FSTOP_COUNT;
+}
+
+// Moves the base one interval up (direction > 0) or down. A table that
+// is dirty anyway only gets its base moved.
+void fstop_shift(fstop_t *m, int8_t direction) {
+    if (m->dirty) {
+        if (m->dirty & DIRTY_RATIO) {
+            m->ratio = pow(2, m->interval);
+            m->dirty &= ~DIRTY_RATIO;
+        }
+        m->base_s = direction > 0 ? m->base_s * m->ratio : m->base_s / m->ratio;
+        return;
+    }
+
+    if (direction > 0) {
+        double top = m->table[ring(m, FSTOP_COUNT - 1)];
+
+        m->table[m->first] = top * m->ratio;
+        m->first = ring(m, 1);
+    } else {
+        double bottom = m->table[m->first];
+
+        m->first = ring(m, FSTOP_COUNT - 1);
+        m->table[m->first] = bottom / m->ratio;
+    }
+    m->base_s = m->table[ring(m, FSTOP_HALF)] * m->scale;
+}
+
+double fstop_base(const fstop_t *m) {
+    return m->base_s;
+}
+
+// Seconds at offset intervals from the base. Offsets past the table
+// continue from its ends, one multiplication per interval.
+double fstop_at(fstop_t *m, int8_t offset) {
+    double t;
+
+    if (m->dirty) {
+        refresh(m);
+    }
+
+    if (offset > FSTOP_HALF) {
+        t = m->table[ring(m, FSTOP_COUNT - 1)];
+        for (offset -= FSTOP_HALF; offset; offset--) {
+            t *= m->ratio;
+        }
+    } else if (offset < -FSTOP_HALF) {
+        t = m->table[m->first];
+        for (offset += FSTOP_HALF; offset; offset++) {
+            t /= m->ratio;
+        }
+    } else {
+        t = m->table[ring(m, offset + FSTOP_HALF)];
+    }
+
+    return t * m->scale;
+}
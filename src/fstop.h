@@ -0,0 +1,36 @@
+#ifndef FSTOP_H
+#define FSTOP_H
+
+// Exposure times a whole number of intervals away from a base time.
+//
+// The model keeps the table around the base and only redoes what an
+// input change invalidates: setting the base or the interval marks it
+// dirty and the next read recomputes it, shifting the base by one
+// interval rotates the table and computes the one entry that comes in,
+// and nudging the base, as to a rounded value, only changes the scale
+// the table is read at.
+
+#include <stdint.h>
+
+// Entries in the table, centred on the base
+#define FSTOP_COUNT 7
+
+typedef struct {
+    double base_s;                  // entry at offset 0
+    double interval;                // stops between entries
+    double ratio;                   // 2^interval
+    double table[FSTOP_COUNT];      // ring, seconds at offsets -3..3
+    double scale;                   // of the table, to seconds
+    uint8_t first;                  // ring index of the lowest offset
+    uint8_t dirty;
+} fstop_t;
+
+void fstop_init(fstop_t *m, double base_s, double interval);
+void fstop_set_base(fstop_t *m, double base_s);
+void fstop_rescale(fstop_t *m, double base_s);
+void fstop_set_interval(fstop_t *m, double interval);
+void fstop_shift(fstop_t *m, int8_t direction);
+double fstop_base(const fstop_t *m);
+double fstop_at(fstop_t *m, int8_t offset);
+
+#endif
@@ -0,0 +1,145 @@
+// atmega328p backend: peripheral setup and interrupt vectors
+#include "hal.h"
+
+// MCUSR as it was at reset. WDRF has to be cleared before the watchdog
+// can be turned off, and after a watchdog reset it keeps running at
+// its shortest period, so this happens before the C runtime starts.
+// So does driving the relay low: from reset to here the pin is an
+// input and the relay driver sees whatever its pull-down makes of it.
+uint8_t hal_reset_flags HAL_NOINIT;
+
+__attribute__((naked, used, section(".init3")))
+static void early_init(void) {
+    hal_gpio_clear(PIN_RELAY);
+    hal_gpio_output(PIN_RELAY);
+
+    hal_reset_flags = MCUSR;
+    MCUSR = 0;
+    wdt_disable();
+}
+
+void hal_tick_init(void) {
+    OCR1A = HAL_TICK_COUNTS_PER_MS - 1;
+    TCCR1A = 0;
+    TCCR1B = _BV(WGM12) | HAL_TIMER_CS(BOARD_TICK_PRESCALER); // CTC
+    TIMSK1 |= _BV(OCIE1A);
+}
+
+ISR(TIMER1_COMPA_vect)
+{
+    exposure_tick();
+}
+
+void hal_poll_init(void) {
+    OCR0A = HAL_POLL_TOP - 1;
+    TCCR0A = _BV(WGM01); // CTC, so the top can follow the clock
+    TCCR0B = HAL_TIMER_CS(BOARD_POLL_PRESCALER);
+    TIMSK0 |= _BV(OCIE0A);
+}
+
+ISR(TIMER0_COMPA_vect)
+{
+    input_poll();
+}
+
+void hal_spi_init(void) {
+    hal_gpio_output(PIN_SPI_SCK);
+    hal_gpio_output(PIN_SPI_MOSI);
+    hal_gpio_output(PIN_SPI_SS);
+    SPCR |= _BV(SPE) | _BV(MSTR) | _BV(SPR1); // F_CPU / 64
+}
+
+static uint16_t uart_ubrr;
+static uint16_t uart_ubrr_slow;
+static uint8_t uart_sent;
+static uint8_t clock_is_slow;
+
+// Double speed mode, which halves the rounding error of the divider:
+// 115200 baud is 2.1 % off at 16 MHz instead of 3.5 %.
+static uint16_t ubrr_for(uint32_t clock, uint32_t baud) {
+    return (clock + 4 * baud) / (8 * baud) - 1;
+}
+
+void hal_uart_init(uint32_t baud) {
+    while (uart_sent && !(UCSR0A & _BV(TXC0)));
+
+    uart_ubrr = ubrr_for(F_CPU, baud);
+    uart_ubrr_slow = ubrr_for(F_CPU / BOARD_CLOCK_SLOW_DIV, baud);
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        UCSR0A = _BV(U2X0);
+        UBRR0 = clock_is_slow ? uart_ubrr_slow : uart_ubrr;
+    }
+
+    // Enable rx, rx interrupt and tx
+    UCSR0B |= _BV(RXEN0) | _BV(RXCIE0) | _BV(TXEN0);
+
+    // Set frame format: 8data, 2stop bit
+    UCSR0C = _BV(USBS0) | (3 << UCSZ00);
+}
+
+// TXC0 is cleared with every byte queued, so once it is set again
+// everything has left the shift register.
+void hal_uart_tx_start(void) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        UCSR0A = _BV(TXC0) | _BV(U2X0); // the other writable bits stay 0
+        UCSR0B |= _BV(UDRIE0);
+    }
+    uart_sent = 1;
+}
+
+ISR(USART_RX_vect)
+{
+    uint8_t status = UCSR0A;
+
+    uart_rx_byte(UDR0, status & _BV(DOR0));
+}
+
+ISR(USART_UDRE_vect)
+{
+    int16_t c = uart_tx_next();
+
+    if (c < 0) {
+        UCSR0B &= ~_BV(UDRIE0);
+    } else {
+        UDR0 = c;
+    }
+}
+
+_Static_assert(BOARD_CLOCK_SLOW_DIV == 8, "SPI rate below is worked out for a divide by 8");
+
+// Switch the core between F_CPU and F_CPU / BOARD_CLOCK_SLOW_DIV and
+// retune everything clocked from it in the same critical section, so
+// the tick and poll rates, the UART baud rate and the SPI bit rate all
+// stay as they are. Timer1 keeps counting through the switch, only
+// the partial prescaler period is lost, under one count (4 us).
+//
+// A byte being shifted out would be garbled, so this waits for the
+// transmitter to go idle. One arriving at that moment can be lost.
+void hal_clock_slow(uint8_t slow) {
+    while (uart_sent && !(UCSR0A & _BV(TXC0)));
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        clock_is_slow = slow;
+        if (slow) {
+            clock_prescale_set(__builtin_ctz(BOARD_CLOCK_SLOW_DIV));
+            TCCR1B = _BV(WGM12) | HAL_TIMER_CS(BOARD_TICK_PRESCALER_SLOW);
+            TCCR0B = HAL_TIMER_CS(BOARD_POLL_PRESCALER_SLOW);
+            OCR0A = HAL_POLL_TOP_SLOW - 1;
+            UBRR0 = uart_ubrr_slow;
+            SPSR |= _BV(SPI2X); // F_CPU / 8 / 8, the F_CPU / 64 of full speed
+            SPCR = (SPCR & ~(_BV(SPR1) | _BV(SPR0))) | _BV(SPR0);
+        } else {
+            clock_prescale_set(clock_div_1);
+            TCCR1B = _BV(WGM12) | HAL_TIMER_CS(BOARD_TICK_PRESCALER);
+            TCCR0B = HAL_TIMER_CS(BOARD_POLL_PRESCALER);
+            OCR0A = HAL_POLL_TOP - 1;
+            UBRR0 = uart_ubrr;
+            SPSR &= ~_BV(SPI2X);
+            SPCR = (SPCR & ~(_BV(SPR1) | _BV(SPR0))) | _BV(SPR1);
+        }
+        if (TCNT0 >= OCR0A) {
+            TCNT0 = 0; // top moved below the count, don't wait for a wrap
+        }
+    }
+}
@@ -0,0 +1,160 @@
+#ifndef HAL_PORT_H
+#define HAL_PORT_H
+
+// atmega328p backend, v1 boards. Pins and timer settings come from
+// board.h.
+
+#include <stdint.h>
+
+#include "board.h"
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/eeprom.h>
+#include <avr/pgmspace.h>
+#include <avr/power.h>
+#include <avr/sleep.h>
+#include <avr/wdt.h>
+#include <util/atomic.h>
+
+/* GPIO ----------------------------------------------------------------- */
+
+#define HAL_GPIO_OUTPUT(port, bit)       (DDR##port |= _BV(bit))
+#define HAL_GPIO_INPUT_PULLUP(port, bit) (DDR##port &= ~_BV(bit), PORT##port |= _BV(bit))
+#define HAL_GPIO_SET(port, bit)          (PORT##port |= _BV(bit))
+#define HAL_GPIO_CLEAR(port, bit)        (PORT##port &= ~_BV(bit))
+#define HAL_GPIO_READ(port, bit)         ((PIN##port >> (bit)) & 1)
+
+#define hal_gpio_output(pin)       HAL_GPIO_OUTPUT(pin)
+#define hal_gpio_input_pullup(pin) HAL_GPIO_INPUT_PULLUP(pin)
+#define hal_gpio_set(pin)          HAL_GPIO_SET(pin)
+#define hal_gpio_clear(pin)        HAL_GPIO_CLEAR(pin)
+#define hal_gpio_read(pin)         HAL_GPIO_READ(pin)
+
+/* Timer clock select bits for a prescaler, 0 when the AVR has none ---- */
+
+#define HAL_TIMER_CS(prescaler) \
+    ((prescaler) == 1 ? 1 : (prescaler) == 8 ? 2 : (prescaler) == 64 ? 3 : \
+     (prescaler) == 256 ? 4 : (prescaler) == 1024 ? 5 : 0)
+
+/* Exposure tick: Timer1, CTC ---------------------------------------------- */
+
+#define HAL_TICK_PRESCALER     BOARD_TICK_PRESCALER
+#define HAL_TICK_COUNTS_PER_MS (F_CPU / HAL_TICK_PRESCALER / 1000)
+
+_Static_assert(HAL_TIMER_CS(BOARD_TICK_PRESCALER), "no such Timer1 prescaler");
+_Static_assert(HAL_TICK_COUNTS_PER_MS * HAL_TICK_PRESCALER * 1000 == F_CPU,
+               "tick prescaler does not divide F_CPU into whole ms");
+
+void hal_tick_init(void);
+
+static inline uint16_t hal_tick_counts(void) {
+    return TCNT1;
+}
+
+static inline uint8_t hal_tick_pending(void) {
+    return (TIFR1 & _BV(OCF1A)) != 0;
+}
+
+// CTC mode has no double buffering, TCNT1 has just been cleared when
+// the tick interrupt calls this so the new top applies to this tick.
+static inline void hal_tick_trim(int8_t counts) {
+    OCR1A = HAL_TICK_COUNTS_PER_MS - 1 + counts;
+}
+
+/* Input poll: Timer0, CTC ----------------------------------------------- */
+
+// Counts per poll at full and at the slow clock, same poll rate
+#define HAL_POLL_TOP      256
+#define HAL_POLL_TOP_SLOW (HAL_POLL_TOP * BOARD_POLL_PRESCALER / BOARD_CLOCK_SLOW_DIV \
+                           / BOARD_POLL_PRESCALER_SLOW)
+
+#define HAL_POLL_US (HAL_POLL_TOP * BOARD_POLL_PRESCALER / (F_CPU / 1000000UL))
+
+_Static_assert(HAL_TIMER_CS(BOARD_POLL_PRESCALER), "no such Timer0 prescaler");
+
+void hal_poll_init(void);
+
+/* Clock scaling: CLKPR ------------------------------------------------- */
+
+_Static_assert(HAL_TIMER_CS(BOARD_TICK_PRESCALER_SLOW)
+               && BOARD_TICK_PRESCALER_SLOW * BOARD_CLOCK_SLOW_DIV == BOARD_TICK_PRESCALER,
+               "no Timer1 prescaler keeps the tick at the slow clock");
+_Static_assert(HAL_TIMER_CS(BOARD_POLL_PRESCALER_SLOW) && HAL_POLL_TOP_SLOW <= 256
+               && HAL_POLL_TOP_SLOW * BOARD_POLL_PRESCALER_SLOW * BOARD_CLOCK_SLOW_DIV
+                  == HAL_POLL_TOP * BOARD_POLL_PRESCALER,
+               "no Timer0 setting keeps the poll rate at the slow clock");
+_Static_assert((BOARD_CLOCK_SLOW_DIV & (BOARD_CLOCK_SLOW_DIV - 1)) == 0
+               && BOARD_CLOCK_SLOW_DIV <= 256, "CLKPR divides by powers of two");
+
+void hal_clock_slow(uint8_t slow);
+
+/* SPI ------------------------------------------------------------------ */
+
+void hal_spi_init(void);
+
+static inline void hal_spi_write(uint8_t data) {
+    SPDR = data;
+    while (!(SPSR & _BV(SPIF)));
+}
+
+static inline void hal_spi_flush(void) {
+}
+
+/* UART ----------------------------------------------------------------- */
+
+void hal_uart_init(uint32_t baud);
+void hal_uart_tx_start(void);
+
+/* Storage: on-chip EEPROM ---------------------------------------------- */
+
+#define hal_store_read_byte(p)         eeprom_read_byte(p)
+#define hal_store_read_word(p)         eeprom_read_word(p)
+#define hal_store_read_dword(p)        eeprom_read_dword(p)
+#define hal_store_update_byte(p, v)    eeprom_update_byte((p), (v))
+#define hal_store_update_word(p, v)    eeprom_update_word((p), (v))
+#define hal_store_update_dword(p, v)   eeprom_update_dword((p), (v))
+#define hal_store_ready()              eeprom_is_ready()
+
+/* Watchdog: WDT in system reset mode --------------------------------- */
+
+// The 128 kHz watchdog oscillator is not calibrated, the datasheet
+// only gives typical periods.
+#define HAL_WATCHDOG_MS 60
+#define HAL_NOINIT      __attribute__((section(".noinit")))
+
+extern uint8_t hal_reset_flags;
+
+static inline void hal_watchdog_start(void) {
+    wdt_enable(WDTO_60MS);
+}
+
+static inline void hal_watchdog_stop(void) {
+    wdt_disable();
+}
+
+static inline void hal_watchdog_feed(void) {
+    wdt_reset();
+}
+
+static inline uint8_t hal_watchdog_fired(void) {
+    return (hal_reset_flags & _BV(WDRF)) != 0;
+}
+
+/* System --------------------------------------------------------------- */
+
+static inline void hal_init(void) {
+}
+
+static inline void hal_irq_enable(void) {
+    sei();
+}
+
+// Idle sleep, any interrupt wakes the core. The 1 ms tick bounds the
+// wait if an event slips in between the main loop's check and here.
+static inline void hal_idle(void) {
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    sleep_mode();
+}
+
+#endif
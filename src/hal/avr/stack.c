@@ -0,0 +1,58 @@
+// Stack high-water mark.
+//
+// stack_paint() runs from .init1, before .data and .bss are set up and
+// before anything touches the stack, and fills everything from the
+// end of .bss up to the top of RAM with STACK_CANARY. Nothing in the
+// firmware uses malloc, so the lowest overwritten byte is the deepest
+// the stack has ever been.
+#include <avr/io.h>
+
+#include "stack.h"
+
+extern uint8_t __data_start;
+extern uint8_t _end;
+extern uint8_t __stack;
+
+void stack_paint(void) __attribute__((naked, used, section(".init1")));
+
+void stack_paint(void)
+{
+    // r1 is not cleared yet at this point, so stay in assembler.
+    __asm volatile (
+        "    ldi r30, lo8(_end)\n"
+        "    ldi r31, hi8(_end)\n"
+        "    ldi r24, %0\n"
+        "    ldi r25, hi8(__stack)\n"
+        "    rjmp 2f\n"
+        "1:  st Z+, r24\n"
+        "2:  cpi r30, lo8(__stack)\n"
+        "    cpc r31, r25\n"
+        "    brlo 1b\n"
+        "    breq 1b\n"
+        :
+        : "i" (STACK_CANARY)
+    );
+}
+
+// Bytes taken by .data and .bss.
+uint16_t stack_static(void) {
+    return &_end - &__data_start;
+}
+
+// Bytes between the end of .bss and the stack pointer right now.
+uint16_t stack_free(void) {
+    return SP - (uint16_t) &_end;
+}
+
+// Bytes never touched by the stack since reset, the headroom left.
+uint16_t stack_unused(void) {
+    const uint8_t *p = &_end;
+    uint16_t count = 0;
+
+    while (p <= &__stack && *p == STACK_CANARY) {
+        p++;
+        count++;
+    }
+
+    return count;
+}
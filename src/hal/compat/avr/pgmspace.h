@@ -0,0 +1,23 @@
+#ifndef HAL_COMPAT_PGMSPACE_H
+#define HAL_COMPAT_PGMSPACE_H
+
+// avr-libc program space API for targets where flash is in the normal
+// address space, constant data already stays in flash there.
+
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+#define PSTR(s) (s)
+
+#define pgm_read_byte(p)  (*(const uint8_t *) (p))
+#define pgm_read_word(p)  (*(const uint16_t *) (p))
+#define pgm_read_dword(p) (*(const uint32_t *) (p))
+#define pgm_read_ptr(p)   (*(void * const *) (p))
+
+#define memcpy_P  memcpy
+#define strlen_P  strlen
+#define strcmp_P  strcmp
+#define strncmp_P strncmp
+
+#endif
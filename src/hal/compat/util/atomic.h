@@ -0,0 +1,19 @@
+#ifndef HAL_COMPAT_ATOMIC_H
+#define HAL_COMPAT_ATOMIC_H
+
+// avr-libc ATOMIC_BLOCK on top of hal_irq_save() / hal_irq_restore().
+// Like the original, leaving the block by return or break restores
+// the interrupt state.
+
+#include <stdint.h>
+
+static inline void hal_atomic_restore(const uint32_t *state) {
+    hal_irq_restore(*state);
+}
+
+#define ATOMIC_RESTORESTATE
+#define ATOMIC_BLOCK(type) \
+    for (uint32_t hal_atomic_state __attribute__((cleanup(hal_atomic_restore))) = hal_irq_save(), \
+         hal_atomic_once = 1; hal_atomic_once; hal_atomic_once = 0)
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef HAL_H
+#define HAL_H
+
+// Hardware abstraction for the timer.
+//
+// Shared code talks to the hardware only through this interface. Each
+// backend lives in hal/<platform>/ and provides hal_port.h, which the
+// build puts on the include path:
+//
+//   hal/avr       atmega328p, v1 board (make)
+//   hal/stm32c0   STM32C031K6 + MAX7221, v2 board (make -f Makefile.stm32c0)
+//   hal/host      Linux process, stdin/stdout as UART (make -f Makefile.host)
+//
+// The board itself (F_CPU, pins, display digits, timer prescalers) is
+// described by boards/<name>/board.h, which hal_port.h includes. make
+// BOARD=v1-3digit picks another board for the same backend.
+//
+// hal_port.h defines, usually as static inline or macros so that pin
+// and register accesses fold into single instructions:
+//
+// GPIO, pins are board.h constants like PIN_RELAY
+//   hal_gpio_output(pin)          hal_gpio_input_pullup(pin)
+//   hal_gpio_set(pin)             hal_gpio_clear(pin)
+//   hal_gpio_read(pin)            -> 0 / 1
+//
+// Exposure tick, 1 ms, calls exposure_tick() from its interrupt
+//   HAL_TICK_COUNTS_PER_MS        timer counts in one tick
+//   hal_tick_init()
+//   hal_tick_counts()             counts into the current tick
+//   hal_tick_pending()            tick elapsed but not serviced yet
+//   hal_tick_trim(n)              make the tick that just started n counts longer
+//
+// Input poll, a few ms, calls input_poll() from its interrupt
+//   HAL_POLL_US                   poll period
+//   hal_poll_init()
+//
+// SPI master, display bus
+//   hal_spi_init()
+//   hal_spi_write(byte)           may return before the byte is out
+//   hal_spi_flush()               wait until the bus is idle
+//
+// UART, calls uart_rx_byte() and uart_tx_next() from its interrupts
+//   hal_uart_init(baud)           also changes the rate later, once the
+//                                 transmitter is idle
+//   hal_uart_tx_start()           start draining uart_tx_next()
+//
+// Non-volatile storage, variables are declared EEMEM
+//   hal_store_read_byte/word/dword(p)
+//   hal_store_update_byte/word/dword(p, value)
+//   hal_store_ready()             1 when an update would not wait
+//
+// Watchdog, resets the core unless fed at least every HAL_WATCHDOG_MS
+//   HAL_WATCHDOG_MS               nominal timeout
+//   hal_watchdog_start()          hal_watchdog_stop(), may keep it running
+//   hal_watchdog_feed()
+//   hal_watchdog_fired()          1 when the watchdog caused the last reset
+//   HAL_NOINIT                    variables a watchdog reset leaves alone
+//
+// Clock scaling, rates above are kept across switches
+//   hal_clock_slow(slow)          1: run the core slow, 0: full speed
+//
+// System
+//   (before the C runtime)        relay pin driven low, see the backends
+//   hal_init()                    clocks and power, first thing in main()
+//   hal_irq_enable()
+//   hal_idle()                    called from the main loop when it has nothing to do
+//
+// Critical sections use ATOMIC_BLOCK(ATOMIC_RESTORESTATE) and flash
+// tables use PROGMEM / pgm_read_*(), as on avr-libc. The other
+// backends provide those through hal/compat.
+
+#include <stdint.h>
+
+#include "hal_port.h"
+
+// Handlers the backends call from their interrupts
+void exposure_tick(void);
+void input_poll(void);
+void uart_rx_byte(uint8_t c, uint8_t overrun);
+int16_t uart_tx_next(void);
+
+#endif
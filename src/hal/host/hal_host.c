@@ -0,0 +1,470 @@
+// Host backend: the firmware as a Linux process.
+//
+// Interrupts are emulated. hal_host_service() runs whatever timer and
+// UART "interrupts" are due, and is called from the main loop through
+// hal_idle(), whenever a critical section ends and while the firmware
+// busy-waits on a pin, so the shared code runs unmodified.
+//
+// stdin is the UART receive line, with one addition: lines starting
+// with '@' work the front panel instead of reaching the firmware.
+//
+//   @cw [n]  @ccw [n]   turn the encoder n detents
+//   @click              press the encoder button
+//   @start  @focus      press START or the focus toggle
+//   @test  @print       move the mode switch
+//   @wait ms            stop reading stdin for a while
+//
+// UART output goes to stdout, relay edges and display changes to
+// stderr. The process exits once the end of stdin has been read and
+// the firmware has taken everything before it.
+//
+// A hang stops hal_host_service() along with everything else, so the
+// watchdog runs off SIGALRM instead. When it fires the relay is
+// reported off and the process starts over, with the HAL_NOINIT
+// variables carried across in a memory file the way RAM survives a
+// reset on the boards. stdin is inherited, a script carries on.
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+
+#include "hal.h"
+#include "uart.h"
+
+#define FRAME_US (2 * HAL_POLL_US) // each panel frame is seen by at least one poll
+#define FRAMES   256
+
+#define NOINIT_ENV "TIMER_HOST_NOINIT"
+
+static uint8_t irq_enabled;
+static uint8_t in_irq;
+static uint8_t tick_on;
+static uint8_t poll_on;
+static uint8_t uart_on;
+static uint64_t next_tick_us;
+static uint64_t next_poll_us;
+static uint64_t stdin_wait_us;
+static uint8_t stdin_eof;
+
+static uint8_t pins[HAL_PIN_COUNT];
+
+static uint8_t frames[FRAMES][HAL_PIN_COUNT];
+static uint8_t frame_head;
+static uint16_t frame_count;
+static uint64_t next_frame_us;
+
+static char line[64];
+static uint8_t line_len;
+static uint8_t line_start = 1;
+static uint8_t line_panel;
+
+static uint8_t spi_bytes[2];
+static uint8_t spi_count;
+static uint8_t digits[8];
+static uint8_t scan_limit = 7;
+static uint8_t display_dirty;
+
+static volatile uint64_t watchdog_fed_us;
+static uint8_t watchdog_reset;
+
+extern uint8_t __start_hal_noinit[] __attribute__((weak));
+extern uint8_t __stop_hal_noinit[] __attribute__((weak));
+
+static uint64_t now_us(void) {
+    static struct timespec start;
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    if (!start.tv_sec && !start.tv_nsec) {
+        start = ts;
+    }
+
+    return (uint64_t) (ts.tv_sec - start.tv_sec) * 1000000 + (ts.tv_nsec - start.tv_nsec) / 1000;
+}
+
+static void log_event(const char *what) {
+    fprintf(stderr, "[%8.3f] %s\n", now_us() / 1000000.0, what);
+}
+
+/* Front panel ---------------------------------------------------------- */
+
+// Queue a frame that is the current panel state with pin set to level.
+static void frame_push(uint8_t pin, uint8_t level) {
+    uint8_t *last = frame_count ? frames[(uint8_t) (frame_head + frame_count - 1)] : pins;
+    uint8_t *frame;
+
+    if (frame_count == FRAMES) {
+        return;
+    }
+    frame = frames[(uint8_t) (frame_head + frame_count)];
+    memcpy(frame, last, HAL_PIN_COUNT);
+    frame[pin] = level;
+
+    if (!frame_count) {
+        next_frame_us = now_us();
+    }
+    frame_count++;
+}
+
+static void frame_press(uint8_t pin) {
+    frame_push(pin, 0);
+    frame_push(pin, 0);
+    frame_push(pin, 0);
+    frame_push(pin, 1);
+    frame_push(pin, 1);
+}
+
+// Quadrature, both lines active low. CW leads with B.
+static void frame_turn(uint8_t lead, uint8_t lag, uint16_t detents) {
+    while (detents--) {
+        frame_push(lead, 0);
+        frame_push(lag, 0);
+        frame_push(lead, 1);
+        frame_push(lag, 1);
+    }
+}
+
+static void frames_advance(void) {
+    uint64_t now;
+
+    if (!frame_count) {
+        return;
+    }
+
+    now = now_us();
+    while (frame_count && now >= next_frame_us) {
+        memcpy(pins + PIN_ROT_A, frames[frame_head] + PIN_ROT_A, PIN_MODE - PIN_ROT_A + 1);
+        frame_head++;
+        frame_count--;
+        next_frame_us += FRAME_US;
+    }
+}
+
+static void panel_command(char *cmd) {
+    char *arg = strchr(cmd, ' ');
+    uint16_t n = 1;
+
+    if (arg) {
+        *arg++ = '\0';
+        n = atoi(arg);
+    }
+
+    if (!strcmp(cmd, "cw")) {
+        frame_turn(PIN_ROT_B, PIN_ROT_A, n);
+    } else if (!strcmp(cmd, "ccw")) {
+        frame_turn(PIN_ROT_A, PIN_ROT_B, n);
+    } else if (!strcmp(cmd, "click")) {
+        frame_press(PIN_ROT_SW);
+    } else if (!strcmp(cmd, "start")) {
+        frame_press(PIN_START);
+    } else if (!strcmp(cmd, "focus")) {
+        frame_press(PIN_TOGGLE);
+    } else if (!strcmp(cmd, "test")) {
+        frame_push(PIN_MODE, 0);
+    } else if (!strcmp(cmd, "print")) {
+        frame_push(PIN_MODE, 1);
+    } else if (!strcmp(cmd, "wait")) {
+        stdin_wait_us = now_us() + n * 1000ULL;
+    } else {
+        fprintf(stderr, "unknown panel command @%s\n", cmd);
+    }
+}
+
+/* UART ----------------------------------------------------------------- */
+
+// Stops reading while the receive buffer is full, as a host waiting
+// for the firmware would, so piped input is never dropped.
+static void stdin_poll(void) {
+    char c;
+
+    while (!stdin_eof && now_us() >= stdin_wait_us && uart_available() < RX_BUFSIZE - 1) {
+        ssize_t n = read(STDIN_FILENO, &c, 1);
+
+        if (n == 0) {
+            stdin_eof = 1;
+        }
+        if (n <= 0) {
+            return;
+        }
+
+        if (line_start) {
+            line_panel = c == '@';
+            line_len = 0;
+        }
+        line_start = c == '\n';
+
+        if (!line_panel) {
+            uart_rx_byte(c, 0);
+        } else if (c == '\n') {
+            line[line_len] = '\0';
+            panel_command(line + 1);
+        } else if (line_len < sizeof(line) - 1) {
+            line[line_len++] = c;
+        }
+    }
+}
+
+static void uart_drain(void) {
+    int16_t c;
+
+    while ((c = uart_tx_next()) >= 0) {
+        putchar(c);
+    }
+    fflush(stdout);
+}
+
+/* Interrupts ----------------------------------------------------------- */
+
+void hal_host_service(void) {
+    uint64_t now;
+
+    frames_advance();
+
+    if (!irq_enabled || in_irq) {
+        return;
+    }
+    in_irq = 1;
+
+    now = now_us();
+    while (tick_on && now >= next_tick_us) {
+        next_tick_us += 1000;
+        exposure_tick();
+    }
+
+    if (poll_on && now >= next_poll_us) {
+        next_poll_us = now + HAL_POLL_US;
+        input_poll();
+    }
+
+    if (uart_on) {
+        stdin_poll();
+        uart_drain();
+    }
+
+    in_irq = 0;
+}
+
+uint32_t hal_irq_save(void) {
+    uint32_t state = irq_enabled;
+
+    irq_enabled = 0;
+    return state;
+}
+
+// Like sei on the AVR, anything that became due meanwhile runs now.
+void hal_irq_restore(uint32_t state) {
+    irq_enabled = state;
+    if (state) {
+        hal_host_service();
+    }
+}
+
+void hal_irq_enable(void) {
+    hal_irq_restore(1);
+}
+
+/* Peripherals ---------------------------------------------------------- */
+
+void hal_gpio_write(uint8_t pin, uint8_t level) {
+    if (pin == PIN_RELAY && pins[pin] != level) {
+        log_event(level ? "relay on" : "relay off");
+    }
+#if BOARD_CHANNELS > 1
+    if (pin == PIN_CHANNEL_1 && pins[pin] != level) {
+        log_event(level ? "channel 1 on" : "channel 1 off");
+    }
+#endif
+#if BOARD_CHANNELS > 2
+    if (pin == PIN_CHANNEL_2 && pins[pin] != level) {
+        log_event(level ? "channel 2 on" : "channel 2 off");
+    }
+#endif
+
+    // MAX7219 latches register and data on the rising edge of LOAD
+    if (pin == PIN_SPI_SS && level && !pins[pin] && spi_count == 2) {
+        if (spi_bytes[0] >= 0x01 && spi_bytes[0] <= 0x08) {
+            digits[spi_bytes[0] - 1] = spi_bytes[1];
+            display_dirty = 1;
+        } else if (spi_bytes[0] == 0x0B) {
+            scan_limit = spi_bytes[1] & 7;
+        } else if (spi_bytes[0] == 0x0A) {
+            char line[32];
+
+            snprintf(line, sizeof(line), "display intensity %u", spi_bytes[1] & 0x0F);
+            log_event(line);
+        } else if (spi_bytes[0] == 0x0C) {
+            log_event(spi_bytes[1] & 1 ? "display on" : "display shutdown");
+        }
+    }
+    if (pin == PIN_SPI_SS && !level) {
+        spi_count = 0;
+    }
+
+    pins[pin] = level;
+}
+
+uint8_t hal_gpio_read(uint8_t pin) {
+    hal_host_service();
+    return pins[pin];
+}
+
+void hal_tick_init(void) {
+    next_tick_us = now_us() + 1000;
+    tick_on = 1;
+}
+
+uint16_t hal_tick_counts(void) {
+    int64_t into = 1000 - (int64_t) (next_tick_us - now_us());
+
+    if (into < 0) {
+        into = 0;
+    } else if (into > 999) {
+        into = 999;
+    }
+
+    return into * HAL_TICK_COUNTS_PER_MS / 1000;
+}
+
+void hal_poll_init(void) {
+    next_poll_us = now_us();
+    poll_on = 1;
+}
+
+void hal_spi_init(void) {
+    pins[PIN_SPI_SS] = 1;
+}
+
+void hal_spi_write(uint8_t data) {
+    if (spi_count < 2) {
+        spi_bytes[spi_count++] = data;
+    }
+}
+
+void hal_uart_init(uint32_t baud) {
+    (void) baud;
+    fcntl(STDIN_FILENO, F_SETFL, fcntl(STDIN_FILENO, F_GETFL) | O_NONBLOCK);
+    uart_on = 1;
+}
+
+void hal_uart_tx_start(void) {
+    if (!in_irq) {
+        uart_drain();
+    }
+}
+
+/* Watchdog ------------------------------------------------------------- */
+
+static void watchdog_timer(long interval_us) {
+    struct itimerval timer = { { 0, interval_us }, { 0, interval_us } };
+
+    setitimer(ITIMER_REAL, &timer, NULL);
+}
+
+static void watchdog_alarm(int sig) {
+    uint64_t late = now_us() - watchdog_fed_us;
+    char text[96];
+    int fd;
+
+    (void) sig;
+    if (late < HAL_WATCHDOG_MS * 1000) {
+        return;
+    }
+
+    // Nothing that takes a stdio lock from here on
+    write(STDERR_FILENO, text, snprintf(text, sizeof(text),
+          "[%8.3f] watchdog reset, %u us after the last feed%s\n", now_us() / 1000000.0,
+          (unsigned) late, pins[PIN_RELAY] ? ", relay off" : ""));
+
+    watchdog_timer(0); // timers outlive exec
+    fd = memfd_create("noinit", 0);
+    write(fd, __start_hal_noinit, __stop_hal_noinit - __start_hal_noinit);
+    snprintf(text, sizeof(text), "%s=%d", NOINIT_ENV, fd);
+    execle("/proc/self/exe", "timer_host", (char *) NULL, (char *[]) { text, NULL });
+    _exit(1);
+}
+
+void hal_watchdog_start(void) {
+    struct sigaction action = { .sa_handler = watchdog_alarm, .sa_flags = SA_RESTART };
+    sigset_t alarm;
+
+    // Still blocked if this process was started from the handler
+    sigemptyset(&alarm);
+    sigaddset(&alarm, SIGALRM);
+    sigprocmask(SIG_UNBLOCK, &alarm, NULL);
+    sigaction(SIGALRM, &action, NULL);
+    hal_watchdog_feed();
+    watchdog_timer(1000);
+}
+
+void hal_watchdog_stop(void) {
+    watchdog_timer(0);
+}
+
+void hal_watchdog_feed(void) {
+    watchdog_fed_us = now_us();
+}
+
+uint8_t hal_watchdog_fired(void) {
+    return watchdog_reset;
+}
+
+// Takes the noinit variables back from the process the watchdog ended.
+static void noinit_restore(void) {
+    const char *fd = getenv(NOINIT_ENV);
+
+    if (fd) {
+        pread(atoi(fd), __start_hal_noinit, __stop_hal_noinit - __start_hal_noinit, 0);
+        close(atoi(fd));
+        unsetenv(NOINIT_ENV);
+        watchdog_reset = 1;
+    }
+}
+
+/* System --------------------------------------------------------------- */
+
+void hal_init(void) {
+    memset(pins, 1, sizeof(pins)); // pull-ups, mode switch in PRINT
+    pins[PIN_RELAY] = 0;
+    noinit_restore();
+}
+
+// Code B font of the MAX7219
+static void display_print(void) {
+    static const char font[] = "0123456789-EHLP ";
+    char text[2 * 8 + 10];
+    char *p = text + sprintf(text, "display ");
+
+    for (int8_t i = scan_limit; i >= 0; i--) {
+        *p++ = font[digits[i] & 0x0F];
+        if (digits[i] & 0x80) {
+            *p++ = '.';
+        }
+    }
+    *p = '\0';
+
+    log_event(text);
+}
+
+void hal_idle(void) {
+    struct timespec pause = {0, 200000};
+
+    hal_host_service();
+
+    if (display_dirty) {
+        display_dirty = 0;
+        display_print();
+    }
+
+    if (stdin_eof && !uart_available()) {
+        uart_drain();
+        exit(0);
+    }
+
+    nanosleep(&pause, NULL);
+}
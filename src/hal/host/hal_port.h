@@ -0,0 +1,99 @@
+#ifndef HAL_PORT_H
+#define HAL_PORT_H
+
+// Host backend: runs the firmware as a Linux process. stdin and stdout
+// are the UART, the timers come from the monotonic clock and the
+// front panel is driven by '@' lines on stdin, see hal_host.c.
+
+#include <stdint.h>
+
+#include "board.h"
+
+/* Interrupts, emulated: they run from hal_host_service() ---------------- */
+
+uint32_t hal_irq_save(void);
+void hal_irq_restore(uint32_t state);
+void hal_host_service(void);
+
+#include <avr/pgmspace.h>
+#include <util/atomic.h>
+
+/* GPIO, pins index the emulated pin array --------------------------- */
+
+void hal_gpio_write(uint8_t pin, uint8_t level);
+uint8_t hal_gpio_read(uint8_t pin);
+
+#define hal_gpio_output(pin)
+#define hal_gpio_input_pullup(pin)
+#define hal_gpio_set(pin)   hal_gpio_write((pin), 1)
+#define hal_gpio_clear(pin) hal_gpio_write((pin), 0)
+
+/* Exposure tick -------------------------------------------------------- */
+
+#define HAL_TICK_COUNTS_PER_MS 250
+
+void hal_tick_init(void);
+uint16_t hal_tick_counts(void);
+
+static inline uint8_t hal_tick_pending(void) {
+    return 0;
+}
+
+static inline void hal_tick_trim(int8_t counts) {
+    (void) counts; // the host clock needs no trim
+}
+
+/* Input poll ----------------------------------------------------------- */
+
+#define HAL_POLL_US 4000
+
+void hal_poll_init(void);
+
+/* SPI ------------------------------------------------------------------ */
+
+void hal_spi_init(void);
+void hal_spi_write(uint8_t data);
+
+static inline void hal_spi_flush(void) {
+}
+
+/* UART ----------------------------------------------------------------- */
+
+void hal_uart_init(uint32_t baud);
+void hal_uart_tx_start(void);
+
+/* Storage: plain RAM, lost on exit ------------------------------------- */
+
+#define EEMEM
+
+#define hal_store_read_byte(p)       (*(p))
+#define hal_store_read_word(p)       (*(p))
+#define hal_store_read_dword(p)      (*(p))
+#define hal_store_update_byte(p, v)  (*(p) = (v))
+#define hal_store_update_word(p, v)  (*(p) = (v))
+#define hal_store_update_dword(p, v) (*(p) = (v))
+#define hal_store_ready()            1
+
+/* Watchdog: SIGALRM, the process starts over when it fires ------------ */
+
+#define HAL_WATCHDOG_MS 100
+#define HAL_NOINIT      __attribute__((section("hal_noinit")))
+
+void hal_watchdog_start(void);
+void hal_watchdog_stop(void);
+void hal_watchdog_feed(void);
+uint8_t hal_watchdog_fired(void);
+
+/* Clock scaling -------------------------------------------------------- */
+
+static inline void hal_clock_slow(uint8_t slow) {
+    (void) slow;
+}
+
+/* System --------------------------------------------------------------- */
+
+void hal_init(void);
+void hal_irq_enable(void);
+void hal_idle(void);
+
+#endif
@@ -0,0 +1,14 @@
+// Stack high-water mark, not measured on the host.
+#include "stack.h"
+
+uint16_t stack_static(void) {
+    return 0;
+}
+
+uint16_t stack_free(void) {
+    return 0;
+}
+
+uint16_t stack_unused(void) {
+    return 0;
+}
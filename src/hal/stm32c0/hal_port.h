@@ -0,0 +1,192 @@
+#ifndef HAL_PORT_H
+#define HAL_PORT_H
+
+// STM32C031K6 backend, v2 board. Pins and timer settings come from
+// board.h.
+
+#include <stdint.h>
+
+#include "board.h"
+#include "stm32c0.h"
+
+/* Interrupts, needed by the compat ATOMIC_BLOCK ---------------------- */
+
+static inline uint32_t hal_irq_save(void) {
+    uint32_t primask;
+
+    __asm volatile ("mrs %0, primask" : "=r" (primask));
+    __asm volatile ("cpsid i" ::: "memory");
+    return primask;
+}
+
+static inline void hal_irq_restore(uint32_t primask) {
+    __asm volatile ("msr primask, %0" :: "r" (primask) : "memory");
+}
+
+#include <avr/pgmspace.h>
+#include <util/atomic.h>
+
+/* GPIO ----------------------------------------------------------------- */
+
+#define HAL_GPIO_MODE(port, bit, mode) \
+    (GPIO##port->MODER = (GPIO##port->MODER & ~(3u << 2 * (bit))) | ((mode) << 2 * (bit)))
+#define HAL_GPIO_AF(port, bit, af) \
+    (GPIO##port->AFR[(bit) >> 3] = (GPIO##port->AFR[(bit) >> 3] & ~(15u << 4 * ((bit) & 7))) \
+                                   | ((af) << 4 * ((bit) & 7)), \
+     HAL_GPIO_MODE(port, bit, GPIO_MODE_AF))
+
+#define HAL_GPIO_OUTPUT(port, bit)       HAL_GPIO_MODE(port, bit, GPIO_MODE_OUTPUT)
+#define HAL_GPIO_INPUT_PULLUP(port, bit) \
+    (GPIO##port->PUPDR = (GPIO##port->PUPDR & ~(3u << 2 * (bit))) | (GPIO_PULL_UP << 2 * (bit)), \
+     HAL_GPIO_MODE(port, bit, GPIO_MODE_INPUT))
+#define HAL_GPIO_SET(port, bit)          (GPIO##port->BSRR = 1u << (bit))
+#define HAL_GPIO_CLEAR(port, bit)        (GPIO##port->BRR = 1u << (bit))
+#define HAL_GPIO_READ(port, bit)         ((GPIO##port->IDR >> (bit)) & 1)
+#define HAL_GPIO_IS_SET(port, bit)       ((GPIO##port->ODR >> (bit)) & 1)
+
+#define hal_gpio_output(pin)       HAL_GPIO_OUTPUT(pin)
+#define hal_gpio_input_pullup(pin) HAL_GPIO_INPUT_PULLUP(pin)
+#define hal_gpio_set(pin)          HAL_GPIO_SET(pin)
+#define hal_gpio_clear(pin)        HAL_GPIO_CLEAR(pin)
+#define hal_gpio_read(pin)         HAL_GPIO_READ(pin)
+#define hal_gpio_af(pin, af)       HAL_GPIO_AF(pin, af)
+#define hal_gpio_is_set(pin)       HAL_GPIO_IS_SET(pin)
+
+/* Exposure tick: TIM3 update ------------------------------------------- */
+
+#define HAL_TICK_PRESCALER     BOARD_TICK_PRESCALER
+#define HAL_TICK_COUNTS_PER_MS (F_CPU / HAL_TICK_PRESCALER / 1000)
+
+_Static_assert(HAL_TICK_PRESCALER <= 65536, "TIM3 prescaler is 16 bit");
+_Static_assert(HAL_TICK_COUNTS_PER_MS * HAL_TICK_PRESCALER * 1000 == F_CPU,
+               "tick prescaler does not divide F_CPU into whole ms");
+
+void hal_tick_init(void);
+
+static inline uint16_t hal_tick_counts(void) {
+    return TIM3->CNT;
+}
+
+static inline uint8_t hal_tick_pending(void) {
+    return TIM3->SR & TIM_SR_UIF;
+}
+
+// ARR is not preloaded, the counter has just wrapped when the tick
+// interrupt calls this so the new top applies to this tick.
+static inline void hal_tick_trim(int8_t counts) {
+    TIM3->ARR = HAL_TICK_COUNTS_PER_MS - 1 + counts;
+}
+
+/* Input poll: TIM14 update every BOARD_POLL_MS ------------------------- */
+
+#define HAL_POLL_US (BOARD_POLL_MS * 1000)
+
+void hal_poll_init(void);
+
+/* SPI: SPI1, transmit only --------------------------------------------- */
+
+void hal_spi_init(void);
+
+static inline void hal_spi_write(uint8_t data) {
+    while (!(SPI1->SR & SPI_SR_TXE));
+    *(volatile uint8_t *) &SPI1->DR = data; // byte access, or the FIFO packs two
+}
+
+static inline void hal_spi_flush(void) {
+    while (SPI1->SR & (SPI_SR_FTLVL | SPI_SR_BSY));
+}
+
+/* UART: USART1 --------------------------------------------------------- */
+
+void hal_uart_init(uint32_t baud);
+
+static inline void hal_uart_tx_start(void) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        USART1->CR1 |= USART_CR1_TXEIE;
+    }
+}
+
+/* Storage: last flash page with a RAM copy ----------------------------- */
+
+// EEMEM variables are linked into a NOLOAD section at the same address
+// as on the AVR, so their addresses work as offsets into the copy.
+#define EEMEM __attribute__((section(".eeprom")))
+#define HAL_STORE_SIZE 1024
+
+void hal_store_read(const void *p, void *data, uint8_t n);
+void hal_store_update(void *p, const void *data, uint8_t n);
+
+static inline uint8_t hal_store_read_byte(const uint8_t *p) {
+    uint8_t value;
+
+    hal_store_read(p, &value, sizeof(value));
+    return value;
+}
+
+static inline uint16_t hal_store_read_word(const uint16_t *p) {
+    uint16_t value;
+
+    hal_store_read(p, &value, sizeof(value));
+    return value;
+}
+
+static inline uint32_t hal_store_read_dword(const uint32_t *p) {
+    uint32_t value;
+
+    hal_store_read(p, &value, sizeof(value));
+    return value;
+}
+
+static inline void hal_store_update_byte(uint8_t *p, uint8_t value) {
+    hal_store_update(p, &value, sizeof(value));
+}
+
+static inline void hal_store_update_word(uint16_t *p, uint16_t value) {
+    hal_store_update(p, &value, sizeof(value));
+}
+
+static inline void hal_store_update_dword(uint32_t *p, uint32_t value) {
+    hal_store_update(p, &value, sizeof(value));
+}
+
+// Updates only touch the RAM copy.
+static inline uint8_t hal_store_ready(void) {
+    return 1;
+}
+
+/* Watchdog: IWDG ------------------------------------------------------- */
+
+// LSI / 8, 4 kHz nominal. The timeout has to outlast a store page
+// erase, which stalls the tick for about 25 ms.
+#define HAL_WATCHDOG_MS 100
+#define HAL_NOINIT      __attribute__((section(".noinit")))
+
+void hal_watchdog_start(void);
+uint8_t hal_watchdog_fired(void);
+
+// Once started the IWDG only stops with a power cycle, feeding it
+// stays the caller's job.
+static inline void hal_watchdog_stop(void) {
+}
+
+static inline void hal_watchdog_feed(void) {
+    IWDG->KR = IWDG_KEY_RELOAD;
+}
+
+/* Clock scaling -------------------------------------------------------- */
+
+// Not implemented on the C0 yet, HSIDIV would do the same job as CLKPR.
+static inline void hal_clock_slow(uint8_t slow) {
+    (void) slow;
+}
+
+/* System --------------------------------------------------------------- */
+
+void hal_init(void);
+void hal_idle(void);
+
+static inline void hal_irq_enable(void) {
+    __asm volatile ("cpsie i" ::: "memory");
+}
+
+#endif
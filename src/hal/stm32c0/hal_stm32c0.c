@@ -0,0 +1,234 @@
+// STM32C031 backend: clocks, peripheral setup, interrupt handlers and
+// the flash backed storage
+#include <string.h>
+
+#include "hal.h"
+
+// Tick first, it owns the relay edges
+#define PRIORITY_TICK 0x00
+#define PRIORITY_UART 0x40
+#define PRIORITY_POLL 0x80
+
+static void irq_enable(uint8_t irq, uint8_t priority) {
+    NVIC_IPR[irq] = priority;
+    NVIC_ISER[0] = 1u << irq;
+}
+
+/* System --------------------------------------------------------------- */
+
+static void store_load(void);
+
+static uint8_t reset_by_watchdog;
+
+// First thing in Reset_Handler, before .data and .bss are set up:
+// the relay pin leaves reset in analog mode, undriven, until this
+// makes it a low output.
+void hal_early_init(void) {
+    RCC->IOPENR |= RCC_IOPENR_GPIOAEN | RCC_IOPENR_GPIOBEN | RCC_IOPENR_GPIOCEN;
+    hal_gpio_clear(PIN_RELAY);
+    hal_gpio_output(PIN_RELAY);
+}
+
+// SYSCLK from HSI48 undivided (reset runs at 12 MHz), one flash wait state.
+void hal_init(void) {
+    FLASH->ACR = FLASH_ACR_LATENCY_1 | FLASH_ACR_ICEN;
+    while ((FLASH->ACR & 7) != FLASH_ACR_LATENCY_1);
+    RCC->CR &= ~RCC_CR_HSIDIV_MASK;
+
+    reset_by_watchdog = (RCC->CSR2 & RCC_CSR2_IWDGRSTF) != 0;
+    RCC->CSR2 |= RCC_CSR2_RMVF;
+
+    store_load();
+}
+
+/* Watchdog ------------------------------------------------------------- */
+
+static uint8_t watchdog_started;
+
+// Only the first start programs the period, which waits for the slow
+// LSI domain, later ones are a reload.
+void hal_watchdog_start(void) {
+    if (watchdog_started) {
+        hal_watchdog_feed();
+        return;
+    }
+    watchdog_started = 1;
+
+    IWDG->KR = IWDG_KEY_START;
+    IWDG->KR = IWDG_KEY_ACCESS;
+    IWDG->PR = IWDG_PR_DIV8;
+    IWDG->RLR = HAL_WATCHDOG_MS * 4 - 1;
+    while (IWDG->SR);
+    IWDG->KR = IWDG_KEY_RELOAD;
+}
+
+uint8_t hal_watchdog_fired(void) {
+    return reset_by_watchdog;
+}
+
+/* Exposure tick -------------------------------------------------------- */
+
+void hal_tick_init(void) {
+    RCC->APBENR1 |= RCC_APBENR1_TIM3EN;
+    TIM3->PSC = HAL_TICK_PRESCALER - 1;
+    TIM3->ARR = HAL_TICK_COUNTS_PER_MS - 1;
+    TIM3->EGR = TIM_EGR_UG; // load PSC
+    TIM3->SR = 0;
+    TIM3->DIER = TIM_DIER_UIE;
+    TIM3->CR1 = TIM_CR1_CEN;
+    irq_enable(TIM3_IRQn, PRIORITY_TICK);
+}
+
+void TIM3_IRQHandler(void) {
+    TIM3->SR = ~TIM_SR_UIF;
+    exposure_tick();
+}
+
+/* Input poll ----------------------------------------------------------- */
+
+void hal_poll_init(void) {
+    RCC->APBENR2 |= RCC_APBENR2_TIM14EN;
+    TIM14->PSC = F_CPU / 1000 - 1;
+    TIM14->ARR = BOARD_POLL_MS - 1;
+    TIM14->EGR = TIM_EGR_UG;
+    TIM14->SR = 0;
+    TIM14->DIER = TIM_DIER_UIE;
+    TIM14->CR1 = TIM_CR1_CEN;
+    irq_enable(TIM14_IRQn, PRIORITY_POLL);
+}
+
+void TIM14_IRQHandler(void) {
+    TIM14->SR = ~TIM_SR_UIF;
+    input_poll();
+}
+
+/* SPI ------------------------------------------------------------------ */
+
+// Transmit only on MOSI, 6 MHz clock, well inside the MAX7221's 10 MHz.
+void hal_spi_init(void) {
+    RCC->APBENR2 |= RCC_APBENR2_SPI1EN;
+
+    hal_gpio_set(PIN_SPI_SS);
+    hal_gpio_output(PIN_SPI_SS);
+    hal_gpio_af(PIN_SPI_SCK, 0);
+    hal_gpio_af(PIN_SPI_MOSI, 0);
+
+    SPI1->CR2 = SPI_CR2_DS_8BIT;
+    SPI1->CR1 = SPI_CR1_BIDIMODE | SPI_CR1_BIDIOE | SPI_CR1_SSM | SPI_CR1_SSI
+              | SPI_CR1_BR_DIV8 | SPI_CR1_MSTR | SPI_CR1_SPE;
+}
+
+/* UART ----------------------------------------------------------------- */
+
+void hal_uart_init(uint32_t baud) {
+    // BRR only takes a write with the USART off
+    if (USART1->CR1 & USART_CR1_UE) {
+        while (!(USART1->ISR & USART_ISR_TC));
+        USART1->CR1 = 0;
+    }
+
+    RCC->APBENR2 |= RCC_APBENR2_USART1EN;
+
+    hal_gpio_af(PIN_UART_TX, 1);
+    hal_gpio_af(PIN_UART_RX, 1);
+
+    USART1->BRR = (F_CPU + baud / 2) / baud;
+    USART1->CR2 = USART_CR2_STOP_2; // 8N2 like the v1 board
+    USART1->CR1 = USART_CR1_UE | USART_CR1_RE | USART_CR1_TE | USART_CR1_RXNEIE;
+    irq_enable(USART1_IRQn, PRIORITY_UART);
+}
+
+void USART1_IRQHandler(void) {
+    uint32_t isr = USART1->ISR;
+
+    if (isr & (USART_ISR_RXNE | USART_ISR_ORE)) {
+        USART1->ICR = USART_ICR_ORECF;
+        if (isr & USART_ISR_RXNE) {
+            uart_rx_byte(USART1->RDR, (isr & USART_ISR_ORE) != 0);
+        }
+    }
+
+    if ((USART1->CR1 & USART_CR1_TXEIE) && (isr & USART_ISR_TXE)) {
+        int16_t c = uart_tx_next();
+
+        if (c < 0) {
+            USART1->CR1 &= ~USART_CR1_TXEIE;
+        } else {
+            USART1->TDR = c;
+        }
+    }
+}
+
+/* Storage -------------------------------------------------------------- */
+
+// The C031 has no EEPROM. The settings live in a RAM copy that is
+// loaded from the last flash page at startup and written back from
+// hal_idle(). Erasing the page stalls the CPU, tick interrupt included,
+// for about 25 ms, so that waits until the relay is off.
+
+extern uint8_t __eeprom_start;
+extern uint8_t __store_page;
+
+static uint8_t store[HAL_STORE_SIZE] __attribute__((aligned(8)));
+static uint8_t store_dirty;
+
+static void store_load(void) {
+    memcpy(store, &__store_page, sizeof(store));
+}
+
+void hal_store_read(const void *p, void *data, uint8_t n) {
+    memcpy(data, store + ((const uint8_t *) p - &__eeprom_start), n);
+}
+
+void hal_store_update(void *p, const void *data, uint8_t n) {
+    uint8_t *dst = store + ((uint8_t *) p - &__eeprom_start);
+
+    if (memcmp(dst, data, n)) {
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            memcpy(dst, data, n);
+            store_dirty = 1;
+        }
+    }
+}
+
+static void flash_wait(void) {
+    while (FLASH->SR & FLASH_SR_BSY1);
+}
+
+static void store_commit(void) {
+    uint32_t page = ((uint32_t) &__store_page - 0x08000000) / FLASH_PAGE_SIZE;
+    volatile uint32_t *dst = (volatile uint32_t *) &__store_page;
+    const uint32_t *src = (const uint32_t *) store;
+
+    FLASH->KEYR = FLASH_KEY1;
+    FLASH->KEYR = FLASH_KEY2;
+    FLASH->SR = FLASH_SR_ERRORS | FLASH_SR_EOP;
+
+    flash_wait();
+    FLASH->CR = FLASH_CR_PER | (page << FLASH_CR_PNB_POS);
+    FLASH->CR |= FLASH_CR_STRT;
+    flash_wait();
+
+    // 64 bit words, the RAM copy may change underneath between them
+    FLASH->CR = FLASH_CR_PG;
+    for (uint16_t i = 0; i < HAL_STORE_SIZE / 4; i += 2) {
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            dst[i] = src[i];
+            dst[i + 1] = src[i + 1];
+        }
+        flash_wait();
+    }
+
+    FLASH->CR = FLASH_CR_LOCK;
+}
+
+/* Idle ----------------------------------------------------------------- */
+
+void hal_idle(void) {
+    if (store_dirty && !hal_gpio_is_set(PIN_RELAY)) {
+        store_dirty = 0;
+        store_commit();
+    }
+
+    __asm volatile ("wfi");
+}
@@ -0,0 +1,49 @@
+// Stack high-water mark, see hal/avr/stack.c.
+//
+// Called from Reset_Handler after .data and .bss are set up. The
+// reset handler's own frame sits at the top of RAM, so painting stops
+// a little below the current stack pointer.
+#include "stack.h"
+
+extern uint8_t _sdata;
+extern uint8_t _end;
+extern uint8_t _estack;
+
+static inline uint8_t *stack_pointer(void) {
+    uint8_t *sp;
+
+    __asm volatile ("mov %0, sp" : "=r" (sp));
+    return sp;
+}
+
+void stack_paint(void) {
+    uint8_t *p = &_end;
+    uint8_t *top = stack_pointer() - 32;
+
+    while (p < top) {
+        *p++ = STACK_CANARY;
+    }
+}
+
+// Bytes taken by .data and .bss.
+uint16_t stack_static(void) {
+    return &_end - &_sdata;
+}
+
+// Bytes between the end of .bss and the stack pointer right now.
+uint16_t stack_free(void) {
+    return stack_pointer() - &_end;
+}
+
+// Bytes never touched by the stack since reset, the headroom left.
+uint16_t stack_unused(void) {
+    const uint8_t *p = &_end;
+    uint16_t count = 0;
+
+    while (p < &_estack && *p == STACK_CANARY) {
+        p++;
+        count++;
+    }
+
+    return count;
+}
@@ -0,0 +1,59 @@
+// STM32C031 reset handler and vector table
+#include <stdint.h>
+
+extern uint32_t _sidata, _sdata, _edata, _sbss, _ebss, _estack;
+
+int main(void);
+void stack_paint(void);
+void hal_early_init(void);
+
+void Reset_Handler(void) {
+    const uint32_t *src = &_sidata;
+    uint32_t *dst = &_sdata;
+
+    hal_early_init();
+
+    while (dst < &_edata) {
+        *dst++ = *src++;
+    }
+    for (dst = &_sbss; dst < &_ebss; dst++) {
+        *dst = 0;
+    }
+
+    stack_paint();
+    main();
+
+    while (1);
+}
+
+void Default_Handler(void) {
+    while (1);
+}
+
+#define HANDLER(name) void name(void) __attribute__((weak, alias("Default_Handler")))
+
+HANDLER(NMI_Handler);
+HANDLER(HardFault_Handler);
+HANDLER(SVC_Handler);
+HANDLER(PendSV_Handler);
+HANDLER(SysTick_Handler);
+HANDLER(TIM3_IRQHandler);
+HANDLER(TIM14_IRQHandler);
+HANDLER(USART1_IRQHandler);
+
+// Only the interrupts the HAL uses get their own entry, the rest of
+// the 32 device vectors fall through to Default_Handler.
+__attribute__((section(".isr_vector"), used))
+void (* const vectors[16 + 32])(void) = {
+    [0]  = (void (*)(void)) &_estack,
+    [1]  = Reset_Handler,
+    [2]  = NMI_Handler,
+    [3]  = HardFault_Handler,
+    [11] = SVC_Handler,
+    [14] = PendSV_Handler,
+    [15] = SysTick_Handler,
+    [16 + 0 ... 16 + 31] = Default_Handler,
+    [16 + 16] = TIM3_IRQHandler,
+    [16 + 19] = TIM14_IRQHandler,
+    [16 + 27] = USART1_IRQHandler,
+};
@@ -0,0 +1,124 @@
+#ifndef STM32C0_H
+#define STM32C0_H
+
+// The few STM32C031 registers the HAL touches, from RM0490. Only
+// what is used here, not a replacement for the CMSIS device header.
+
+#include <stdint.h>
+
+#define REG volatile uint32_t
+
+typedef struct {
+    REG CR, ICSCR, CFGR, RESERVED0[3], CIER, CIFR, CICR, IOPRSTR, AHBRSTR,
+        APBRSTR1, APBRSTR2, IOPENR, AHBENR, APBENR1, APBENR2, IOPSMENR, AHBSMENR,
+        APBSMENR1, APBSMENR2, CCIPR, RESERVED1, CSR1, CSR2;
+} rcc_t;
+
+typedef struct {
+    REG ACR, RESERVED0, KEYR, OPTKEYR, SR, CR;
+} flash_t;
+
+typedef struct {
+    REG MODER, OTYPER, OSPEEDR, PUPDR, IDR, ODR, BSRR, LCKR, AFR[2], BRR;
+} gpio_t;
+
+typedef struct {
+    REG CR1, CR2, SMCR, DIER, SR, EGR, CCMR1, CCMR2, CCER, CNT, PSC, ARR;
+} tim_t;
+
+typedef struct {
+    REG CR1, CR2, SR, DR;
+} spi_t;
+
+typedef struct {
+    REG KR, PR, RLR, SR, WINR;
+} iwdg_t;
+
+typedef struct {
+    REG CR1, CR2, CR3, BRR, GTPR, RTOR, RQR, ISR, ICR, RDR, TDR;
+} usart_t;
+
+#define RCC    ((rcc_t *) 0x40021000)
+#define FLASH  ((flash_t *) 0x40022000)
+#define GPIOA  ((gpio_t *) 0x50000000)
+#define GPIOB  ((gpio_t *) 0x50000400)
+#define GPIOC  ((gpio_t *) 0x50000800)
+#define TIM3   ((tim_t *) 0x40000400)
+#define TIM14  ((tim_t *) 0x40002000)
+#define SPI1   ((spi_t *) 0x40013000)
+#define IWDG   ((iwdg_t *) 0x40003000)
+#define USART1 ((usart_t *) 0x40013800)
+
+#define NVIC_ISER ((REG *) 0xE000E100)
+#define NVIC_IPR  ((volatile uint8_t *) 0xE000E400)
+
+#define RCC_CR_HSIDIV_MASK   (7u << 11)
+#define RCC_IOPENR_GPIOAEN   (1u << 0)
+#define RCC_IOPENR_GPIOBEN   (1u << 1)
+#define RCC_IOPENR_GPIOCEN   (1u << 2)
+#define RCC_APBENR1_TIM3EN   (1u << 1)
+#define RCC_APBENR2_SPI1EN   (1u << 12)
+#define RCC_APBENR2_USART1EN (1u << 14)
+#define RCC_APBENR2_TIM14EN  (1u << 15)
+#define RCC_CSR2_RMVF        (1u << 23)
+#define RCC_CSR2_IWDGRSTF    (1u << 29)
+
+#define FLASH_ACR_LATENCY_1  (1u << 0)
+#define FLASH_ACR_ICEN       (1u << 9)
+#define FLASH_SR_BSY1        (1u << 16)
+#define FLASH_SR_ERRORS      0xC3FAu
+#define FLASH_SR_EOP         (1u << 0)
+#define FLASH_CR_PG          (1u << 0)
+#define FLASH_CR_PER         (1u << 1)
+#define FLASH_CR_PNB_POS     3
+#define FLASH_CR_STRT        (1u << 16)
+#define FLASH_CR_LOCK        (1u << 31)
+#define FLASH_KEY1           0x45670123u
+#define FLASH_KEY2           0xCDEF89ABu
+#define FLASH_PAGE_SIZE      2048
+
+#define TIM_CR1_CEN          (1u << 0)
+#define TIM_DIER_UIE         (1u << 0)
+#define TIM_SR_UIF           (1u << 0)
+#define TIM_EGR_UG           (1u << 0)
+
+#define IWDG_KEY_START       0xCCCCu
+#define IWDG_KEY_RELOAD      0xAAAAu
+#define IWDG_KEY_ACCESS      0x5555u
+#define IWDG_PR_DIV8         1u
+
+#define SPI_CR1_MSTR         (1u << 2)
+#define SPI_CR1_BR_DIV8      (2u << 3)
+#define SPI_CR1_SPE          (1u << 6)
+#define SPI_CR1_SSI          (1u << 8)
+#define SPI_CR1_SSM          (1u << 9)
+#define SPI_CR1_BIDIOE       (1u << 14)
+#define SPI_CR1_BIDIMODE     (1u << 15)
+#define SPI_CR2_DS_8BIT      (7u << 8)
+#define SPI_SR_TXE           (1u << 1)
+#define SPI_SR_BSY           (1u << 7)
+#define SPI_SR_FTLVL         (3u << 11)
+
+#define USART_CR1_UE         (1u << 0)
+#define USART_CR1_RE         (1u << 2)
+#define USART_CR1_TE         (1u << 3)
+#define USART_CR1_RXNEIE     (1u << 5)
+#define USART_CR1_TXEIE      (1u << 7)
+#define USART_CR2_STOP_2     (2u << 12)
+#define USART_ISR_ORE        (1u << 3)
+#define USART_ISR_RXNE       (1u << 5)
+#define USART_ISR_TC         (1u << 6)
+#define USART_ISR_TXE        (1u << 7)
+#define USART_ICR_ORECF      (1u << 3)
+
+// Interrupt numbers
+#define TIM3_IRQn   16
+#define TIM14_IRQn  19
+#define USART1_IRQn 27
+
+#define GPIO_MODE_INPUT  0u
+#define GPIO_MODE_OUTPUT 1u
+#define GPIO_MODE_AF     2u
+#define GPIO_PULL_UP     1u
+
+#endif
@@ -0,0 +1,69 @@
+// Front panel buttons and switches, active low with pull-ups. The
+// HAL calls input_poll() every few ms from its poll timer.
+#include "hal.h"
+#include "input.h"
+#include "rotary.h"
+#include "event.h"
+#include "trace.h"
+
+void input_init(void) {
+    init_rotary();
+    rotary_reset_status();
+
+    hal_gpio_input_pullup(PIN_START);
+    hal_gpio_input_pullup(PIN_TOGGLE);
+    hal_gpio_input_pullup(PIN_MODE);
+
+    hal_poll_init();
+}
+
+void input_poll(void) {
+    static int16_t rotary_counter_last;
+    static uint8_t start_history = 0xFF;
+    static uint8_t toggle_history = 0xFF;
+    static uint8_t mode_history;
+    static uint8_t mode_last = 0xFF;
+
+    // reading rotary and button
+    rotary_check_status();
+
+    // One event per poll, detents the queue has not taken yet follow
+    // on the next polls rather than being merged into one
+    int16_t moved = rotary_get_counter() - rotary_counter_last;
+    if (moved) {
+        int8_t step = moved > 0 ? 1 : -1;
+
+        event_put(step > 0 ? EV_ENC_CW : EV_ENC_CCW);
+        TRACE(TR_ENCODER, step);
+        rotary_counter_last += step;
+    }
+
+    if (rotary_get_status() == 3) {
+        event_put(EV_ENC_CLICK);
+        TRACE(TR_BUTTON, EV_ENC_CLICK);
+        rotary_reset_status();
+    }
+
+    // Buttons: released, then low on two polls in a row
+    start_history = (start_history << 1) | hal_gpio_read(PIN_START);
+    if ((start_history & 0x07) == 0x04) {
+        event_put(EV_START);
+        TRACE(TR_BUTTON, EV_START);
+    }
+
+    toggle_history = (toggle_history << 1) | hal_gpio_read(PIN_TOGGLE);
+    if ((toggle_history & 0x07) == 0x04) {
+        event_put(EV_FOCUS);
+        TRACE(TR_BUTTON, EV_FOCUS);
+    }
+
+    // Mode switch: report a position once it has been stable for
+    // four polls. The first report after reset syncs the UI.
+    mode_history = (mode_history << 1) | hal_gpio_read(PIN_MODE);
+    uint8_t mode = mode_history & 0x0F;
+    if ((mode == 0x00 || mode == 0x0F) && mode != mode_last) {
+        event_put(mode ? EV_MODE_PRINT : EV_MODE_TEST);
+        TRACE(TR_BUTTON, mode ? EV_MODE_PRINT : EV_MODE_TEST);
+        mode_last = mode;
+    }
+}
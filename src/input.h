@@ -0,0 +1,9 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+// Front panel inputs: encoder, buttons and the mode switch, polled
+// from a timer interrupt and turned into events.
+
+void input_init(void);
+
+#endif
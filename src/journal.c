@@ -0,0 +1,207 @@
+// Exposure journal: a byte ring of variable length records.
+//
+// A record is a header byte followed by its fields as LEB128 varints:
+//
+//   header   0 K B P llll   K key, B base present, P program present,
+//                           llll payload length in bytes
+//   base     key: base_ds, else zigzag delta to the previous record
+//   program  one byte
+//   offset   zigzag stop offset
+//   driven   key: ms, else zigzag delta to the previous record
+//
+// Fields other than offset and driven are left out while they do not
+// change, a repeated print is three bytes. Every JOURNAL_KEY_EVERY-th
+// record is a key with all fields absolute, so losing the oldest
+// records to the ring only loses the deltas up to the next key.
+//
+// The region holds the newest records from offset 0 to head, then
+// erased bytes up to tail, then the rest of the previous lap. Before
+// writing at head the records from tail on are erased until the new
+// record and one spare byte fit, and a record that does not fit
+// before the end first erases the rest of the region and starts over
+// at 0. Each byte is thus erased and written once per lap, whatever
+// the record sizes, and the spare byte finds head again at startup.
+//
+// Records are written header first and erased header last. The last
+// payload byte always ends a varint, below 0x80, so a record cut
+// short by a reset still has its length and reads as incomplete.
+#include <stdio.h>
+
+#include "hal.h"
+#include "journal.h"
+#include "uart.h"
+
+#define J_KEY  0x40
+#define J_BASE 0x20
+#define J_PROG 0x10
+#define J_LEN  0x0F
+
+#define RECORD_MAX 12
+
+// Erased EEPROM, 0x00 too so the host backend's zeroed store reads as blank
+#define IS_FREE(h) ((h) == 0xFF || ((h) & J_LEN) == 0)
+
+static uint8_t EEMEM journal_ee[JOURNAL_SIZE];
+
+static uint16_t journal_head;       // where the next record goes
+static uint16_t journal_tail;       // oldest record of the previous lap
+static uint16_t erase_end;          // end of the tail record being erased
+static uint8_t erase_left;          // bytes of it still to erase
+
+static uint8_t queue[JOURNAL_QUEUE][RECORD_MAX];
+static uint8_t queue_first;
+static uint8_t queue_count;
+static uint8_t write_pos;           // bytes of the first queued record written
+
+// Fields of the last queued record, the base of the next delta
+static uint16_t last_base_ds;
+static uint8_t last_program;
+static uint32_t last_driven_ms;
+static uint8_t since_key = JOURNAL_KEY_EVERY;
+
+static uint8_t read_byte(uint16_t pos) {
+    return hal_store_read_byte(&journal_ee[pos]);
+}
+
+// Header plus payload of the record at pos, clipped to the region.
+static uint16_t record_end(uint16_t pos) {
+    uint16_t end = pos + 1 + (read_byte(pos) & J_LEN);
+
+    return end < JOURNAL_SIZE ? end : JOURNAL_SIZE;
+}
+
+static uint16_t skip_free(uint16_t pos) {
+    while (pos < JOURNAL_SIZE && IS_FREE(read_byte(pos))) {
+        pos++;
+    }
+
+    return pos;
+}
+
+void journal_init(void) {
+    uint16_t pos = 0;
+
+    while (pos < JOURNAL_SIZE && !IS_FREE(read_byte(pos))) {
+        pos = record_end(pos);
+    }
+
+    journal_head = pos;
+    journal_tail = skip_free(pos);
+}
+
+static uint8_t *put_varint(uint8_t *p, uint32_t value) {
+    while (value >= 0x80) {
+        *p++ = value | 0x80;
+        value >>= 7;
+    }
+    *p++ = value;
+
+    return p;
+}
+
+static uint32_t zigzag(int32_t value) {
+    return ((uint32_t) value << 1) ^ (uint32_t) (value >> 31);
+}
+
+// Queues the record, dropped when the queue is full.
+void journal_add(uint16_t base_ds, int8_t offset, uint8_t program, uint32_t driven_ms) {
+    uint8_t *record;
+    uint8_t *p;
+
+    if (queue_count == JOURNAL_QUEUE) {
+        return;
+    }
+    record = queue[(queue_first + queue_count) % JOURNAL_QUEUE];
+    p = record + 1;
+
+    if (since_key >= JOURNAL_KEY_EVERY) {
+        since_key = 0;
+        record[0] = J_KEY | J_BASE | J_PROG;
+        p = put_varint(p, base_ds);
+        *p++ = program;
+        p = put_varint(p, zigzag(offset));
+        p = put_varint(p, driven_ms);
+    } else {
+        record[0] = 0;
+        if (base_ds != last_base_ds) {
+            record[0] |= J_BASE;
+            p = put_varint(p, zigzag((int32_t) base_ds - last_base_ds));
+        }
+        if (program != last_program) {
+            record[0] |= J_PROG;
+            *p++ = program;
+        }
+        p = put_varint(p, zigzag(offset));
+        p = put_varint(p, zigzag(driven_ms - last_driven_ms));
+    }
+    record[0] |= p - record - 1;
+
+    since_key++;
+    last_base_ds = base_ds;
+    last_program = program;
+    last_driven_ms = driven_ms;
+    queue_count++;
+}
+
+// Erases the tail record one byte per call, header last, or moves the
+// tail over erased bytes.
+static void erase_step(void) {
+    if (!erase_left) {
+        if (IS_FREE(read_byte(journal_tail))) {
+            journal_tail = skip_free(journal_tail);
+            return;
+        }
+        erase_end = record_end(journal_tail);
+        erase_left = erase_end - journal_tail;
+    }
+
+    hal_store_update_byte(&journal_ee[journal_tail + --erase_left], 0xFF);
+    if (!erase_left) {
+        journal_tail = erase_end;
+    }
+}
+
+// One store access per ready store. On backends whose store is RAM
+// until later that is the whole queue in one call.
+void journal_poll(void) {
+    while (queue_count && hal_store_ready()) {
+        uint8_t *record = queue[queue_first];
+        uint8_t length = 1 + (record[0] & J_LEN);
+
+        if (!write_pos) {
+            if (journal_head + length + 1 > JOURNAL_SIZE) {
+                if (journal_tail < JOURNAL_SIZE) {
+                    erase_step();
+                    continue;
+                }
+                journal_head = 0;
+                journal_tail = skip_free(0);
+            }
+            if (journal_tail < journal_head + length + 1) {
+                erase_step();
+                continue;
+            }
+        }
+
+        hal_store_update_byte(&journal_ee[journal_head + write_pos], record[write_pos]);
+        if (++write_pos == length) {
+            write_pos = 0;
+            journal_head += length;
+            queue_first = (queue_first + 1) % JOURNAL_QUEUE;
+            queue_count--;
+        }
+    }
+}
+
+// "JL", region size, then the region as stored. Queued records that
+// are not written yet are not part of it.
+void journal_dump(void) {
+    uart_putbyte('J');
+    uart_putbyte('L');
+    uart_putbyte(JOURNAL_SIZE & 0xFF);
+    uart_putbyte(JOURNAL_SIZE >> 8);
+
+    for (uint16_t pos = 0; pos < JOURNAL_SIZE; pos++) {
+        uart_putbyte(read_byte(pos));
+    }
+}
@@ -0,0 +1,31 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+// Exposure journal in non-volatile storage.
+//
+// Every finished print exposure is appended as a short record: base
+// time, stop offset, program and the drive time the tick actually
+// counted. journal_add() only queues the record, journal_poll() writes
+// it a byte at a time whenever the store is ready. The 'journal'
+// command dumps the region, tools/journal.py decodes it.
+
+#include <stdint.h>
+
+// Bytes of EEPROM given to the journal, a record takes 3 to 12
+#define JOURNAL_SIZE 512
+
+// Records between two self-contained ones, older deltas need them
+#define JOURNAL_KEY_EVERY 16
+
+// Records waiting for the store
+#define JOURNAL_QUEUE 2
+
+// Program byte of a record: program number and step within it
+#define JOURNAL_PROGRAM(id, step) ((uint8_t) ((id) << 3 | (step)))
+
+void journal_init(void);
+void journal_add(uint16_t base_ds, int8_t offset, uint8_t program, uint32_t driven_ms);
+void journal_poll(void);
+void journal_dump(void);
+
+#endif
@@ -1,119 +1,125 @@
-#include <stdio.h>
-#include <stdlib.h>
-#include <avr/io.h>
-#include <util/delay.h>
-#include <avr/interrupt.h>
-#include <math.h>
-
-#include "uart.h"
-#include "defines.h"
-#include "rotary.h"
-#include "max7219.h"
-
-FILE uart_str = FDEV_SETUP_STREAM(uart_putchar, uart_getchar, _FDEV_SETUP_RW);
-
-uint8_t rotary_status;
-
-void Timer0_Start(void)
-{
-    TCCR0B |= _BV(CS02); // prescaler 256 ~122 interrupts/s
-    TIMSK0 |= _BV(TOIE0); // Enable Timer0 Overflow interrupts
-
-    sei(); // Set global interrupts
-}
-
-void button_init(void) {
-    DDRD &= ~(_BV(PD3)); // set as input
-    PORTD |= _BV(PD3); // pullup
-}
-
-void calculate_fstops(double seconds, double interval, double *array) {
-    // interval = -3;
-    // for(int i = 0; i < size; ++i) {
-    //     array[i] = seconds * pow(2, (interval + i) * interval
-    // }
-    array[0] = seconds * pow(2, -3 * interval);
-    array[1] = seconds * pow(2, -2 * interval);
-    array[2] = seconds * pow(2, -1 * interval);
-    array[3] = seconds * pow(2, 0 * interval);
-    array[4] = seconds * pow(2, 1 * interval);
-    array[5] = seconds * pow(2, 2 * interval);
-    array[6] = seconds * pow(2, 3 * interval);
-}
-
-
-void counter_start(int seconds)
-{   
-    int num = seconds;
-    seconds *= 10;
-    while (seconds >= 0) {
-        MAX7219_displayNumber(seconds);
-        _delay_ms(100);
-        seconds--;
-    }
-
-    MAX7219_displayNumber(num * 10);
-}
-
-int main()
-{
-    init_rotary();
-    Timer0_Start();
-    uart_init(MYUBRR);
-    rotary_reset_status();
-    spiMasterInit();
-    button_init();
-
-    // Decode mode to "Font Code-B"
-    MAX7219_writeData(MAX7219_MODE_DECODE, 0xFF);
-
-    // Scan limit runs from 0.
-    MAX7219_writeData(MAX7219_MODE_SCAN_LIMIT, DIGITS_IN_USE - 1);
-    MAX7219_writeData(MAX7219_MODE_INTENSITY, 4);
-    MAX7219_writeData(MAX7219_MODE_POWER, ON);
-
-    uint8_t rotary_counter, rotary_counter_last = rotary_get_counter();
-    uint8_t rotary_status = rotary_get_status();
-
-    stdout = &uart_str;
-
-    fprintf(stdout, "Hello World!\n");
-
-    double arr[6] ={0.0};
-    calculate_fstops(5, 0.5, arr);
-
-    MAX7219_displayNumber(arr[5] * 10);
-
-    while (1)
-    {
-        rotary_counter = rotary_get_counter();
-        rotary_status = rotary_get_status();
-
-
-        if (rotary_counter != rotary_counter_last) { 
-            fprintf(stdout, "Counter: %d | Status: %d\n", rotary_counter, rotary_status);
-            MAX7219_displayNumber((int) rotary_counter * 10);
-            // MAX7219_displayNumber(rotary_counter);
-            rotary_counter_last = rotary_counter;
-        }
-
-        if (rotary_status == 3) {
-            fprintf(stdout, "BUTTON CLICKED!\n");
-            counter_start(rotary_counter);
-            rotary_reset_status();
-        }
-
-        if (!(PIND & _BV(PIND3))) {
-            counter_start(rotary_counter);
-        }
-        
-    }
-
-    return 0;
-}
-
-ISR(TIMER0_OVF_vect)
-{
-    // reading rotary and button
-    rotary_check_status();
-}
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "hal.h"
+#include "uart.h"
+#include "defines.h"
+#include "input.h"
+#include "max7219.h"
+#include "event.h"
+#include "exposure.h"
+#include "ui.h"
+#include "cmd.h"
+#include "trace.h"
+#include "fmt.h"
+#include "power.h"
+#include "journal.h"
+#include "panel.h"
+#include "display.h"
+
+#if USE_STDIO
+FILE uart_str = FDEV_SETUP_STREAM(uart_putchar, uart_getchar, _FDEV_SETUP_RW);
+#endif
+
+// Boot runs in stages. The relay pin is driven low before the C
+// runtime starts, see the HAL backends. main() then brings up what
+// the timer needs to be usable, in this order: relay and tick, inputs
+// and UART, the display with the UI's first screen. That is "ready",
+// stamped on the tick timer. What only reports or mirrors, the greeting,
+// the TM1637 panel and the journal scan, comes after it, and the
+// messages go out through the UART buffer without waiting.
+int main()
+{
+    hal_init();
+    exposure_init();
+    input_init();
+    uart_init(BAUD);
+    spiMasterInit();
+    hal_irq_enable();
+
+    // Decode mode to "Font Code-B"
+    MAX7219_writeData(MAX7219_MODE_DECODE, 0xFF);
+
+    // Scan limit runs from 0.
+    MAX7219_writeData(MAX7219_MODE_SCAN_LIMIT, DIGITS_IN_USE - 1);
+
+    // First screen drawn while the display is still shut down
+    ui_init();
+    display_init(ui_get_state());
+
+    uint32_t ready = timebase_stamp();
+
+    panel_init();
+    journal_init();
+
+#if USE_STDIO
+    stdout = &uart_str;
+#endif
+
+    put_str_P(PSTR("Hello World!\n"));
+    put_str_P(PSTR("Ready in "));
+    put_u32(ready * (1000 / TIMEBASE_COUNTS_PER_MS));
+    put_str_P(PSTR(" us\n"));
+
+    if (exposure_interrupted()) {
+        put_str_P(PSTR("Watchdog reset, paused with "));
+        put_fixed(exposure_remaining(), 3);
+        put_str_P(PSTR(" s to go\n"));
+    }
+
+    uint8_t state_last = ui_get_state();
+    uint16_t worst_last = 0;
+
+    while (1)
+    {
+        exposure_alive();
+
+        if (uart_available()) {
+            power_activity();
+        }
+        cmd_poll();
+        panel_poll();
+        display_poll();
+
+        uint8_t event = event_get();
+
+        if (event == EV_NONE) {
+            journal_poll();
+            ui_poll();
+            power_idle();
+            hal_idle();
+            continue;
+        }
+
+        if (event != EV_TICK) {
+            power_activity();
+        }
+
+        ui_dispatch(event);
+
+        if (ui_get_state() != state_last) {
+            state_last = ui_get_state();
+            display_set_state(state_last);
+            put_str_P(PSTR("State: "));
+            put_u16(state_last);
+            put_char('\n');
+
+            if (state_last == UI_RUNNING) {
+                put_str_P(PSTR("Run: "));
+                put_fixed(exposure_get_set(), 3);
+                put_str_P(PSTR(" s, comp "));
+                put_i32(exposure_get_compensation());
+                put_str_P(PSTR(" ms\n"));
+            }
+        }
+
+        if (ui_get_dispatch_worst() > worst_last) {
+            worst_last = ui_get_dispatch_worst();
+            put_str_P(PSTR("Dispatch worst: "));
+            put_u16(worst_last * (1000 / TIMEBASE_COUNTS_PER_MS));
+            put_str_P(PSTR(" us\n"));
+        }
+    }
+
+    return 0;
+}
@@ -5,27 +5,23 @@
  *
  * 668 bytes - ATmega168 - 16MHz
  */
-#include <avr/io.h>
-#include <util/delay.h>
-
+#include "hal.h"
 #include "max7219.h"
+#include "trace.h"
+#include "panel.h"
+#include "display.h"
 
 // char digitsInUse = 1;
 
-void spiMasterInit (void) {
-    // DDRB = (1 << PIN_MOSI) | (1 << PIN_SCK);
-    // SPCR = (1 << SPE) | (1 << MSTR) | (1 << SPR0);
+static long number_last;
 
-    DDRB |= (1 << PIN_SCK) | (1 << PIN_MOSI) | (1 << PIN_SS);
-    SPCR |= (1 << SPE) | (1 << MSTR)| (1<<SPR1);
+void spiMasterInit (void) {
+    hal_spi_init();
 }
 
 void spiSendByte (char databyte)
 {
-    // Copy data into the SPI data register
-    SPDR = databyte;
-    // Wait until transfer is complete
-    while (!(SPSR & (1 << SPIF)));
+    hal_spi_write(databyte);
 }
 
 void MAX7219_writeData(char data_register, char data)
@@ -35,6 +31,8 @@ void MAX7219_writeData(char data_register, char data)
         spiSendByte(data_register);
         // Send the data to be stored
         spiSendByte(data);
+        // Data is latched on the rising edge of LOAD
+        hal_spi_flush();
     MAX7219_LOAD1;
 }
 
@@ -49,45 +47,62 @@ void MAX7219_clearDisplay()
     } while (--i);
 }
 
-void MAX7219_displayNumber(volatile long number) 
+_Static_assert(DISPLAY_DECIMALS < DISPLAY_DIGITS, "decimal point past the last digit");
+
+// Shows number with DISPLAY_DECIMALS digits after the point, so with
+// one decimal 125 is "12.5" and 5 is "0.5". Every digit register is
+// written once, blanks included, so there is no clear-then-draw flicker.
+// While the display is shut down nothing is sent, MAX7219_redraw()
+// catches up when it comes back on.
+void MAX7219_displayNumber(long number)
 {
-    char negative = 0;
+    uint8_t negative = 0;
+    uint8_t i = MAX7219_DIGIT0;
+
+    TRACE(TR_DISPLAY, number);
+    panel_show_number(number);
+
+    number_last = number;
+    if (display_is_off()) {
+        return;
+    }
 
     // Convert negative to positive.
     // Keep a record that it was negative so we can
     // sign it again on the display.
     if (number < 0) {
         negative = 1;
-        number *= -1;
+        number = -number;
     }
 
-    MAX7219_clearDisplay();
-
-    // If number = 0, only show one zero then exit
-    if (number == 0) {
-        MAX7219_writeData(MAX7219_DIGIT0, 0);
-        return;
-    }
-    
-    // Initialization to 0 required in this case,
-    // does not work without it. Not sure why.
-    char i = 0; 
-    
-    // Loop until number is 0.
-    do {
-        // MAX7219_writeData(++i, number % 10);
-        MAX7219_writeData(++i, (i == 0x01) ? number % 10 | MAX7219_CHAR_DP : number % 10);
-        // Actually divide by 10 now.
+    // Digits up to the one carrying the point are always shown. The
+    // count is a board constant, so this part unrolls and the point
+    // needs no test per digit.
+    for (; i < MAX7219_DIGIT0 + DISPLAY_DECIMALS; i++) {
+        MAX7219_writeData(i, number % 10);
         number /= 10;
-    } while (number);
-
-    // Bear in mind that if you only have three digits, and
-    // try to display something like "-256" all that will display
-    // will be "256" because it needs an extra fourth digit to
-    // display the sign.
-    if (negative) {
-        MAX7219_writeData(i, MAX7219_CHAR_NEGATIVE);
     }
+    MAX7219_writeData(i++, number % 10 | (DISPLAY_DECIMALS ? MAX7219_CHAR_DP : 0));
+    number /= 10;
+
+    // Bear in mind that if the digits run out, the sign (and the
+    // top of the number) is dropped: "-256" needs a fourth digit.
+    for (; i < MAX7219_DIGIT0 + DISPLAY_DIGITS; i++) {
+        if (number) {
+            MAX7219_writeData(i, number % 10);
+            number /= 10;
+        } else if (negative) {
+            MAX7219_writeData(i, MAX7219_CHAR_NEGATIVE);
+            negative = 0;
+        } else {
+            MAX7219_writeData(i, MAX7219_CHAR_BLANK);
+        }
+    }
+}
+
+void MAX7219_redraw(void)
+{
+    MAX7219_displayNumber(number_last);
 }
 
 // int main(void)
@@ -1,16 +1,8 @@
-// 16MHz clock
-#define F_CPU 16000000UL
-
-// Outputs, pin definitions
-#define PIN_SCK                   PORTB5
-#define PIN_MOSI                  PORTB3
-#define PIN_SS                    PORTB2
-
 #define ON                        1
 #define OFF                       0
 
-#define MAX7219_LOAD1             PORTB |= (1<<PIN_SS)
-#define MAX7219_LOAD0             PORTB &= ~(1<<PIN_SS)
+#define MAX7219_LOAD1             hal_gpio_set(PIN_SPI_SS)
+#define MAX7219_LOAD0             hal_gpio_clear(PIN_SPI_SS)
 
 #define MAX7219_MODE_DECODE       0x09
 #define MAX7219_MODE_INTENSITY    0x0A
@@ -19,8 +11,6 @@
 #define MAX7219_MODE_TEST         0x0F
 #define MAX7219_MODE_NOOP         0x00
 
-// I only have 3 digits, no point having the
-// rest. You could use more though.
 #define MAX7219_DIGIT0            0x01
 #define MAX7219_DIGIT1            0x02
 #define MAX7219_DIGIT2            0x03
@@ -30,7 +20,8 @@
 #define MAX7219_CHAR_NEGATIVE     0xA 
 #define MAX7219_CHAR_DP           0x80
 
-#define DIGITS_IN_USE 4
+// Digits and decimal point position come from board.h
+#define DIGITS_IN_USE DISPLAY_DIGITS
 
 void spiMasterInit (void);
 
@@ -40,4 +31,6 @@ void MAX7219_writeData(char data_register, char data);
 
 void MAX7219_clearDisplay();
 
-void MAX7219_displayNumber(volatile long number) ;
+void MAX7219_displayNumber(long number);
+
+void MAX7219_redraw(void);
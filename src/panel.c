@@ -0,0 +1,171 @@
+// TM1637 front panel: the digits and up to 16 keys on two wires.
+//
+// The display repeats what MAX7219_displayNumber() shows. The keys map
+// to events through the board's PANEL_KEYS, indexed by the key number
+// TM1637_ScanCodeToKey() gives, and post on the press like the other
+// buttons.
+//
+// The bus is bit-banged at under 100 kHz, so a frame takes around 1 ms
+// and a key scan 0.3 ms. That is too long for the poll interrupt,
+// panel_poll() runs from the main loop instead. A changed frame and a
+// due key scan go out in the same pass, but scans are spaced
+// PANEL_SCAN_MS apart whatever the display does, so the display keeps
+// its update rate while the keys take about 1.5 % of the bus.
+#include "hal.h"
+#include "panel.h"
+
+#if PANEL_ENABLE
+
+#include "TM1637.h"
+#include "event.h"
+#include "exposure.h"
+#include "trace.h"
+
+// Segments a-g in bits 0-6, as the TM1637 takes them
+static const uint8_t panel_font[10] PROGMEM = {
+    0x3F, 0x06, 0x5B, 0x4F, 0x66, 0x6D, 0x7D, 0x07, 0x7F, 0x6F
+};
+
+#define PANEL_MINUS 0x40
+
+static const uint8_t panel_keys[17] PROGMEM = PANEL_KEYS;
+
+static uint8_t frame[DISPLAY_DIGITS];  // leftmost digit first
+static uint8_t frame_dirty;
+static uint32_t scan_last_ms;
+static uint8_t key_last;               // key of the last scan
+static uint8_t key_count;              // scans it has been the same for
+static uint8_t key_down;               // debounced
+
+static void tm_nop(void) {
+}
+
+static void tm_dio_out(void) {
+    hal_gpio_output(PIN_TM1637_DIO);
+}
+
+static void tm_dio_in(void) {
+    hal_gpio_input_pullup(PIN_TM1637_DIO);
+}
+
+static void tm_dio_write(uint8_t level) {
+    if (level) {
+        hal_gpio_set(PIN_TM1637_DIO);
+    } else {
+        hal_gpio_clear(PIN_TM1637_DIO);
+    }
+}
+
+static uint8_t tm_dio_read(void) {
+    return hal_gpio_read(PIN_TM1637_DIO);
+}
+
+static void tm_clk_write(uint8_t level) {
+    if (level) {
+        hal_gpio_set(PIN_TM1637_CLK);
+    } else {
+        hal_gpio_clear(PIN_TM1637_CLK);
+    }
+}
+
+// At least us, in whole tick timer counts and one more for the
+// count already under way.
+static void tm_delay(uint8_t us) {
+    uint16_t start = timebase_now();
+    uint16_t counts = (uint16_t) us * TIMEBASE_COUNTS_PER_MS / 1000 + 1;
+
+    while ((uint16_t) (timebase_now() - start) < counts);
+}
+
+static TM1637_Handler_t tm = {
+    .PlatformInit = tm_nop,
+    .PlatformDeInit = tm_nop,
+    .DioConfigOut = tm_dio_out,
+    .DioConfigIn = tm_dio_in,
+    .DioWrite = tm_dio_write,
+    .DioRead = tm_dio_read,
+    .ClkWrite = tm_clk_write,
+    .DelayUs = tm_delay,
+};
+
+void panel_init(void) {
+    hal_gpio_set(PIN_TM1637_CLK);
+    hal_gpio_output(PIN_TM1637_CLK);
+    tm_dio_out();
+    tm_dio_write(1);
+
+    TM1637_Init(&tm);
+    TM1637_ConfigDisplay(&tm, 7, TM1637DisplayStateON);
+}
+
+// Same layout as MAX7219_displayNumber(), only queued: panel_poll()
+// sends it.
+void panel_show_number(long number) {
+    uint8_t negative = number < 0;
+    uint8_t i = DISPLAY_DIGITS;
+
+    if (negative) {
+        number = -number;
+    }
+
+    while (i--) {
+        uint8_t position = DISPLAY_DIGITS - 1 - i;
+
+        if (number || position <= DISPLAY_DECIMALS) {
+            frame[i] = pgm_read_byte(&panel_font[number % 10]);
+            number /= 10;
+        } else if (negative) {
+            frame[i] = PANEL_MINUS;
+            negative = 0;
+        } else {
+            frame[i] = 0;
+        }
+        if (DISPLAY_DECIMALS && position == DISPLAY_DECIMALS) {
+            frame[i] |= TM1637DecimalPoint;
+        }
+    }
+
+    frame_dirty = 1;
+}
+
+// The press posts the key's event once it has read the same on
+// PANEL_DEBOUNCE scans. A failed scan reads as no key.
+static void panel_scan(void) {
+    uint8_t code = TM1637NoKey;
+    uint8_t key;
+
+    TM1637_ScanKeys(&tm, &code);
+    key = TM1637_ScanCodeToKey(code);
+
+    if (key != key_last) {
+        key_last = key;
+        key_count = 1;
+        return;
+    }
+    if (key_count == PANEL_DEBOUNCE) {
+        return;
+    }
+    if (++key_count == PANEL_DEBOUNCE && key != key_down) {
+        key_down = key;
+        if (key && pgm_read_byte(&panel_keys[key])) {
+            event_put(pgm_read_byte(&panel_keys[key]));
+            TRACE(TR_BUTTON, pgm_read_byte(&panel_keys[key]));
+        }
+    }
+}
+
+void panel_poll(void) {
+    uint32_t now = timebase_millis();
+
+    if (frame_dirty) {
+        frame_dirty = 0;
+        TM1637_SetMultipleDigit(&tm, frame, 0, DISPLAY_DIGITS);
+    }
+
+    if (now - scan_last_ms >= PANEL_SCAN_MS) {
+        scan_last_ms = now;
+        panel_scan();
+    }
+}
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef PANEL_H
+#define PANEL_H
+
+#include "hal.h"
+
+// TM1637 front panel, for boards that define PIN_TM1637_CLK and
+// PIN_TM1637_DIO. It repeats the display and turns its keys into
+// events, see panel.c.
+#ifdef PIN_TM1637_CLK
+#define PANEL_ENABLE 1
+#else
+#define PANEL_ENABLE 0
+#endif
+
+// Key scans are at least this far apart, in ms
+#define PANEL_SCAN_MS 20
+
+// Scans a key has to read the same on in a row to count
+#define PANEL_DEBOUNCE 2
+
+#if PANEL_ENABLE
+
+void panel_init(void);
+void panel_show_number(long number);
+void panel_poll(void);
+
+#else
+
+static inline void panel_init(void) {
+}
+
+static inline void panel_show_number(long number) {
+    (void) number;
+}
+
+static inline void panel_poll(void) {
+}
+
+#endif
+
+#endif
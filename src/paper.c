@@ -0,0 +1,174 @@
+// Paper profiles.
+//
+// Long exposures need more than the metered time because paper loses
+// speed past a few seconds (reciprocity failure), and a print that
+// looks right wet dries down darker. Each profile in flash has a
+// dry-down offset and a piecewise linear reciprocity table, both in
+// stops: the time in stops from 1 s goes in, the stops to add come
+// out, interpolated between the entries and held flat past either
+// end.
+//
+// The times are converted to stops and back with integer log2 and
+// exp2, each a table of 33 entries interpolated linearly, in 1/4096
+// stop. From 1 s up that is within 0.05 % of pow() and a few hundred
+// cycles on the AVR, so a changed time or profile shows corrected on
+// the same display update. Profile 0 leaves the time alone.
+//
+// The numbers below are starting points from typical datasheet
+// curves, not measurements; calibrate against your own paper.
+#include "hal.h"
+#include "paper.h"
+
+typedef struct {
+    int16_t at;         // metered time, stops from 1 s
+    int16_t add;        // correction there, stops
+} paper_point_t;
+
+typedef struct {
+    char name[8];
+    int16_t dry_down;   // stops, added to every time
+    uint8_t count;      // used entries of points
+    paper_point_t points[PAPER_POINTS];
+} paper_t;
+
+#define P(t, add) { PAPER_STOPS(t), PAPER_STOPS(add) }
+
+static const paper_t papers[PAPER_COUNT] PROGMEM = {
+    { "none", 0, 0, { { 0, 0 } } },
+    { "rc", PAPER_STOPS(-0.05), 3, {
+        P(3, 0), P(5, 0.05), P(7, 0.15) } },
+    { "fb", PAPER_STOPS(-0.12), 5, {
+        P(3, 0), P(4, 0.05), P(5, 0.12), P(6, 0.22), P(7, 0.35) } },
+    { "fb-warm", PAPER_STOPS(-0.15), 6, {
+        P(2, 0), P(3, 0.05), P(4, 0.12), P(5, 0.22), P(6, 0.35), P(7, 0.5) } },
+};
+
+// round(4096 * log2(1 + i / 32))
+static const uint16_t log2_table[33] PROGMEM = {
+    0, 182, 358, 530, 696, 858, 1016, 1169, 1319, 1465, 1607, 1746,
+    1882, 2015, 2145, 2272, 2396, 2518, 2637, 2754, 2869, 2982, 3092,
+    3200, 3307, 3412, 3514, 3615, 3715, 3812, 3908, 4003, 4096
+};
+
+// round(32768 * (2^(i / 32) - 1))
+static const uint16_t exp2_table[33] PROGMEM = {
+    0, 718, 1451, 2200, 2966, 3748, 4548, 5365, 6200, 7053, 7925, 8816,
+    9727, 10657, 11608, 12580, 13573, 14588, 15625, 16684, 17767, 18874,
+    20005, 21160, 22341, 23548, 24781, 26041, 27329, 28645, 29989,
+    31364, 32768
+};
+
+// log2(1000) in 1/4096 stop, ms to stops from 1 s
+#define LOG2_1000 40820
+
+static uint8_t profile;
+static uint8_t EEMEM profile_ee;
+
+// Linear between two flash table entries, frac of one step in bits.
+static uint16_t lerp_P(const uint16_t *table, uint8_t i, uint16_t frac, uint8_t bits) {
+    uint16_t lo = pgm_read_word(&table[i]);
+    uint16_t hi = pgm_read_word(&table[i + 1]);
+
+    return lo + (uint16_t) (((uint32_t) (hi - lo) * frac) >> bits);
+}
+
+// log2(ms) in 1/4096 stop, ms at least 1.
+static int32_t log2_q12(uint32_t ms) {
+    uint8_t n = 31;
+
+    while (!(ms & 0x80000000UL)) {
+        ms <<= 1;
+        n--;
+    }
+
+    // 15 bits of mantissa below the leading one, 5 index the table
+    uint16_t f = (ms >> 16) & 0x7FFF;
+
+    return (int32_t) n * 4096 + lerp_P(log2_table, f >> 10, f & 0x3FF, 10);
+}
+
+// 2^(s / 4096) in ms, at least 1.
+static uint32_t exp2_q12(int32_t s) {
+    int8_t n = s >> 12;
+    uint16_t f = s & 0xFFF;
+    uint32_t mantissa = 32768UL + lerp_P(exp2_table, f >> 7, f & 0x7F, 7); // Q15
+
+    if (n < 0) {
+        return 1;
+    }
+    if (n >= 15) {
+        return mantissa << (n - 15);
+    }
+
+    mantissa = (mantissa + (1UL << (14 - n))) >> (15 - n);
+    return mantissa ? mantissa : 1;
+}
+
+// Stops to add at a time of s stops from 1 s, both in 1/4096 stop.
+static int32_t reciprocity(const paper_t *p, int32_t s) {
+    uint8_t count = pgm_read_byte(&p->count);
+    int32_t at_lo = (int32_t) (int16_t) pgm_read_word(&p->points[0].at) * 16;
+    int32_t add_lo = (int32_t) (int16_t) pgm_read_word(&p->points[0].add) * 16;
+
+    if (count == 0) {
+        return 0;
+    }
+    if (s <= at_lo) {
+        return add_lo;
+    }
+
+    for (uint8_t i = 1; i < count; i++) {
+        int32_t at_hi = (int32_t) (int16_t) pgm_read_word(&p->points[i].at) * 16;
+        int32_t add_hi = (int32_t) (int16_t) pgm_read_word(&p->points[i].add) * 16;
+
+        if (s < at_hi) {
+            return add_lo + (add_hi - add_lo) * (s - at_lo) / (at_hi - at_lo);
+        }
+        at_lo = at_hi;
+        add_lo = add_hi;
+    }
+
+    return add_lo;
+}
+
+void paper_init(void) {
+    profile = hal_store_read_byte(&profile_ee);
+    if (profile >= PAPER_COUNT) {
+        profile = 0; // blank EEPROM
+    }
+}
+
+uint8_t paper_get(void) {
+    return profile;
+}
+
+void paper_select(uint8_t p) {
+    if (p < PAPER_COUNT) {
+        profile = p;
+    }
+}
+
+// Only writes if the profile changed.
+void paper_save(void) {
+    hal_store_update_byte(&profile_ee, profile);
+}
+
+// Name in flash, for put_str_P().
+const char *paper_name(uint8_t p) {
+    return papers[p].name;
+}
+
+// Exposure time for a metered ms under a profile.
+uint32_t paper_correct(uint8_t number, uint32_t ms) {
+    const paper_t *p = &papers[number];
+    int32_t s;
+
+    if (number == 0 || number >= PAPER_COUNT || ms == 0) {
+        return ms;
+    }
+
+    s = log2_q12(ms);
+    s += reciprocity(p, s - LOG2_1000) + (int32_t) (int16_t) pgm_read_word(&p->dry_down) * 16;
+
+    return exp2_q12(s);
+}
@@ -0,0 +1,21 @@
+#ifndef PAPER_H
+#define PAPER_H
+
+#include <stdint.h>
+
+// Paper profiles: reciprocity and dry-down corrections applied to the
+// exposure times, see paper.c. Profile 0 applies none.
+#define PAPER_COUNT  4
+#define PAPER_POINTS 6      // reciprocity table entries per profile
+
+// Stops in the tables, 1/256 stop units
+#define PAPER_STOPS(x) ((int16_t) ((x) * 256 + ((x) < 0 ? -0.5 : 0.5)))
+
+void paper_init(void);
+uint8_t paper_get(void);
+void paper_select(uint8_t profile);
+void paper_save(void);
+const char *paper_name(uint8_t profile);
+uint32_t paper_correct(uint8_t profile, uint32_t ms);
+
+#endif
@@ -0,0 +1,76 @@
+// Clock scaling policy.
+//
+// The core runs at full speed while anything is going on: an exposure,
+// the focus lamp or a timed channel, input events, UART traffic. After
+// POWER_IDLE_MS of none of that it drops to the slow clock
+// (hal_clock_slow), and the next input brings it straight back. The timers are retuned by the
+// HAL, so timekeeping is unaffected either way.
+#include "hal.h"
+#include "power.h"
+#include "exposure.h"
+#include "channel.h"
+
+static uint8_t power_slow;
+static uint32_t power_last_ms;
+static uint32_t power_slow_since;
+static uint32_t power_slow_total;
+static uint16_t power_switches;
+static uint16_t power_wake_worst;
+
+// Something happened, full speed from here.
+void power_activity(void) {
+    power_last_ms = timebase_millis();
+
+    if (power_slow) {
+        uint16_t start = timebase_now();
+
+        hal_clock_slow(0);
+        power_slow = 0;
+
+        uint16_t wake = timebase_now() - start;
+        if (wake > power_wake_worst) {
+            power_wake_worst = wake;
+        }
+        power_slow_total += power_last_ms - power_slow_since;
+    }
+}
+
+// Nothing to do in the main loop, slow down once idle long enough.
+// Not while the relay or any channel is timing.
+void power_idle(void) {
+    if (power_slow || exposure_is_running() || hal_gpio_read(PIN_RELAY) || channel_running()) {
+        return;
+    }
+
+    uint32_t now = timebase_millis();
+
+    if (now - power_last_ms >= POWER_IDLE_MS) {
+        hal_clock_slow(1);
+        power_slow = 1;
+        power_slow_since = now;
+        power_switches++;
+    }
+}
+
+uint8_t power_is_slow(void) {
+    return power_slow;
+}
+
+// Times the clock went slow since reset.
+uint16_t power_get_switches(void) {
+    return power_switches;
+}
+
+// Time spent on the slow clock since reset, in ms.
+uint32_t power_get_slow_ms(void) {
+    if (power_slow) {
+        return power_slow_total + timebase_millis() - power_slow_since;
+    }
+
+    return power_slow_total;
+}
+
+// Longest switch back to full speed, in timebase counts.
+uint16_t power_get_wake_worst(void) {
+    return power_wake_worst;
+}
@@ -0,0 +1,16 @@
+#ifndef POWER_H
+#define POWER_H
+
+#include <stdint.h>
+
+// Slow clock after this long without input, UART traffic or relay
+#define POWER_IDLE_MS 2000
+
+void power_activity(void);
+void power_idle(void);
+uint8_t power_is_slow(void);
+uint16_t power_get_switches(void);
+uint32_t power_get_slow_ms(void);
+uint16_t power_get_wake_worst(void);
+
+#endif
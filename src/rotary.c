@@ -1,53 +1,147 @@
-// https://scienceprog.com/interfacing-rotary-encoder-to-avr-microcontroller/
-#include "rotary.h"
-
-uint8_t rotary_status;
-uint8_t rotary_counter;
-
-void init_rotary(void) {
-    // ROTDDR &= ~(_BV(ROTPA)) & ~(_BV(ROTPB)) & ~(_BV(ROTBUTTON)); // Set pins as input
-    ROTDDR &= ~(_BV(ROTPA) | _BV(ROTPB) | _BV(ROTBUTTON)); // Set pins as input
-    ROTPORT |= _BV(ROTPA) | _BV(ROTPB) | _BV(ROTBUTTON); // pull-up pin
-}
-
-void rotary_check_status(void) {
-    if (ROTA & (!ROTB)) {
-        loop_until_bit_is_set(ROTPIN, ROTPA);
-        if (ROTB) {
-            rotary_counter--;
-        }
-    } else if (ROTB & (!ROTA)) {
-        loop_until_bit_is_set(ROTPIN, ROTPB);
-        if (ROTA) {
-            rotary_counter++;
-        }
-    } else if (ROTA & ROTB) {
-        loop_until_bit_is_set(ROTPIN, ROTPA);
-        if (ROTB) {
-            rotary_counter--;
-        } else {
-            rotary_counter++;
-        }
-    }
-    if (ROTCLICK) {
-        loop_until_bit_is_set(ROTPIN, ROTBUTTON);
-        rotary_status = 3;
-    }
-
-}
-
-uint8_t rotary_get_status(void) {
-    return rotary_status;
-}
-
-uint8_t rotary_get_counter(void) {
-    return rotary_counter;
-}
-
-void rotary_reset_status(void) {
-    rotary_status = 0;
-}
-
-void rotary_reset_counter(void) {
-    rotary_counter = 0;
-}
\ No newline at end of file
+// Rotary encoder, decoded from one A/B sample per input poll.
+//
+// Both lines are active low and rest released at a detent. Turning
+// one detent clockwise walks A/B through 11 10 00 01 11, B leading,
+// counter-clockwise the other way round. rotary_step() follows that
+// walk through a state table and reports a direction only when the
+// lines are back at rest after a complete walk. A bouncing line moves
+// the state back and forth between neighbours and a sample that skips
+// a state falls back to the start, so bounce never counts and never
+// counts twice; a detent is lost only when the encoder turns faster
+// than the poll can see each quarter step.
+//
+// The button is debounced like the other front panel buttons.
+#include <stdio.h>
+
+#include "rotary.h"
+#include "uart.h"
+
+enum {
+    R_START = 0,
+    R_CW_BEGIN,
+    R_CW_NEXT,
+    R_CW_FINAL,
+    R_CCW_BEGIN,
+    R_CCW_NEXT,
+    R_CCW_FINAL,
+    R_STATES
+};
+
+// Next state for each A/B sample
+static const uint8_t rotary_table[R_STATES][4] PROGMEM = {
+    [R_START]     = { R_START,     R_CW_BEGIN,  R_CCW_BEGIN, R_START },
+    [R_CW_BEGIN]  = { R_CW_NEXT,   R_CW_BEGIN,  R_START,     R_START },
+    [R_CW_NEXT]   = { R_CW_NEXT,   R_CW_BEGIN,  R_CW_FINAL,  R_START },
+    [R_CW_FINAL]  = { R_CW_NEXT,   R_START,     R_CW_FINAL,  R_START | ROTARY_CW },
+    [R_CCW_BEGIN] = { R_CCW_NEXT,  R_START,     R_CCW_BEGIN, R_START },
+    [R_CCW_NEXT]  = { R_CCW_NEXT,  R_CCW_FINAL, R_CCW_BEGIN, R_START },
+    [R_CCW_FINAL] = { R_CCW_NEXT,  R_CCW_FINAL, R_START,     R_START | ROTARY_CCW },
+};
+
+static uint8_t rotary_state;
+static uint8_t rotary_status;
+static int16_t rotary_counter;
+static uint8_t click_history = 0xFF;
+
+#if ROTARY_CAPTURE
+static uint8_t capture[ROTARY_CAPTURE];
+static uint16_t capture_samples;
+static uint8_t capture_armed;
+static int16_t capture_counted;     // counter at the start, detents at the end
+#endif
+
+void init_rotary(void) {
+    hal_gpio_input_pullup(PIN_ROT_A);
+    hal_gpio_input_pullup(PIN_ROT_B);
+    hal_gpio_input_pullup(PIN_ROT_SW);
+}
+
+// Feeds one A/B sample to the decoder. The direction flags of the
+// returned state are set on the sample that completes a detent.
+uint8_t rotary_step(uint8_t state, uint8_t ab) {
+    return pgm_read_byte(&rotary_table[state & 0x0F][ab & 3]);
+}
+
+void rotary_check_status(void) {
+    uint8_t ab = ROTARY_AB(hal_gpio_read(PIN_ROT_A), hal_gpio_read(PIN_ROT_B));
+
+    rotary_state = rotary_step(rotary_state, ab);
+    if (rotary_state & ROTARY_CW) {
+        rotary_counter++;
+    } else if (rotary_state & ROTARY_CCW) {
+        rotary_counter--;
+    }
+
+#if ROTARY_CAPTURE
+    if (capture_armed) {
+        capture[capture_samples / 4] |= ab << (2 * (capture_samples % 4));
+        if (++capture_samples == ROTARY_CAPTURE * 4) {
+            capture_counted = rotary_counter - capture_counted;
+            capture_armed = 0;
+        }
+    }
+#endif
+
+    // Released, then low on two polls in a row
+    click_history = (click_history << 1) | hal_gpio_read(PIN_ROT_SW);
+    if ((click_history & 0x07) == 0x04) {
+        rotary_status = 3;
+    }
+}
+
+uint8_t rotary_get_status(void) {
+    return rotary_status;
+}
+
+// Detents turned, clockwise positive. Wraps; only differences mean
+// anything.
+int16_t rotary_get_counter(void) {
+    return rotary_counter;
+}
+
+void rotary_reset_status(void) {
+    rotary_status = 0;
+}
+
+void rotary_reset_counter(void) {
+    rotary_counter = 0;
+}
+
+#if ROTARY_CAPTURE
+
+// Records the next ROTARY_CAPTURE * 4 polls of the A/B lines.
+void rotary_capture_start(void) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        for (uint16_t i = 0; i < ROTARY_CAPTURE; i++) {
+            capture[i] = 0;
+        }
+        capture_counted = rotary_counter;
+        capture_samples = 0;
+        capture_armed = 1;
+    }
+}
+
+uint8_t rotary_capture_busy(void) {
+    return capture_armed;
+}
+
+// "EN", sample count, poll period in us, detents the decoder counted
+// meanwhile (all little endian 16 bit), then the samples, four per
+// byte, oldest in the low bits. Only call it once the capture is
+// done. tools/encoder.py fetches it, bench/encoder.c replays it.
+void rotary_capture_dump(void) {
+    uart_putbyte('E');
+    uart_putbyte('N');
+    uart_putbyte(capture_samples);
+    uart_putbyte(capture_samples >> 8);
+    uart_putbyte(HAL_POLL_US & 0xFF);
+    uart_putbyte(HAL_POLL_US >> 8);
+    uart_putbyte(capture_counted);
+    uart_putbyte(capture_counted >> 8);
+
+    for (uint16_t i = 0; i < (capture_samples + 3) / 4; i++) {
+        uart_putbyte(capture[i]);
+    }
+}
+
+#endif
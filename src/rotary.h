@@ -1,20 +1,35 @@
-#include <avr/io.h>
-
-#define ROTPORT PORTD
-#define ROTDDR DDRD
-#define ROTPIN PIND
-
-#define ROTPA PD7
-#define ROTPB PD6
-#define ROTBUTTON PD5
-
-#define ROTA !(ROTPIN & _BV(ROTPA))
-#define ROTB !(ROTPIN & _BV(ROTPB))
-#define ROTCLICK !(ROTPIN & _BV(ROTBUTTON))
-
-void init_rotary(void);
-void rotary_check_status(void);
-uint8_t rotary_get_status(void);
-uint8_t rotary_get_counter(void);
-void rotary_reset_status(void);
-void rotary_reset_counter(void);
+#ifndef ROTARY_H
+#define ROTARY_H
+
+#include "hal.h"
+
+// Encoder lines as a decoder input: A in bit 0, B in bit 1, raw
+// levels, so 3 is the detent with both lines released.
+#define ROTARY_AB(a, b) ((a) | (b) << 1)
+
+// Direction flags in the state rotary_step() returns
+#define ROTARY_CW  0x10
+#define ROTARY_CCW 0x20
+
+// Bytes of A/B samples kept by the capture, four samples per byte.
+// 0 compiles the capture out.
+#ifndef ROTARY_CAPTURE
+#define ROTARY_CAPTURE 128
+#endif
+
+void init_rotary(void);
+void rotary_check_status(void);
+uint8_t rotary_get_status(void);
+int16_t rotary_get_counter(void);
+void rotary_reset_status(void);
+void rotary_reset_counter(void);
+
+uint8_t rotary_step(uint8_t state, uint8_t ab);
+
+#if ROTARY_CAPTURE
+void rotary_capture_start(void);
+uint8_t rotary_capture_busy(void);
+void rotary_capture_dump(void);
+#endif
+
+#endif
@@ -0,0 +1,216 @@
+// Printing session upload.
+//
+// A session is a list of programs, each a base time and up to
+// PROGRAM_STEPS stop offsets, sent by tools/session.py as one blob:
+//
+//   length   2 bytes little endian, of the payload
+//   payload  program count, then per program base_ds (2 bytes little
+//            endian), step count and one signed offset per step
+//   crc      2 bytes little endian, CRC-16/CCITT (0x1021, from
+//            0xFFFF) of length and payload
+//
+// 'load' replies with the bank size, switches the UART to the upload
+// rate and hands the receive buffer to session_poll(), which writes
+// each byte as it comes straight into the bank that is not in use,
+// whenever the store is ready. The host sends SESSION_CHUNK bytes at a
+// time and waits for a '.' after each, so the receive buffer never
+// overflows while the EEPROM catches up; the upload runs at the
+// EEPROM's write rate, about 3.4 ms a byte on the AVR.
+//
+// The complete blob is read back from the bank and checked, CRC,
+// layout and ranges, and only then does the one bank byte flip to it
+// and the UI, if idle, switch to its first program.
+// An upload that is cut short, corrupted or times out leaves the
+// active bank as it was. The result goes out at the upload rate, then
+// the UART returns to BAUD.
+#include "defines.h"
+
+#include <stdio.h>
+
+#include "hal.h"
+#include "session.h"
+#include "uart.h"
+#include "exposure.h"
+#include "ui.h"
+#include "fmt.h"
+
+_Static_assert(SESSION_CHUNK < RX_BUFSIZE, "a chunk must fit the receive buffer");
+
+static uint8_t EEMEM session_ee[2][SESSION_BANK_SIZE];
+static uint8_t EEMEM bank_ee;
+
+static uint8_t bank;                // active bank
+static uint8_t count;               // programs in it, 0 if none
+
+static uint8_t loading;
+static uint16_t load_at;            // bytes received
+static uint16_t load_size;          // bytes expected, once the length is in
+static uint32_t load_last_ms;
+
+static uint16_t crc_update(uint16_t crc, uint8_t b) {
+    crc ^= (uint16_t) b << 8;
+    for (uint8_t i = 0; i < 8; i++) {
+        crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+
+    return crc;
+}
+
+static uint16_t read_u16(const uint8_t *p) {
+    return hal_store_read_byte(p) | hal_store_read_byte(p + 1) << 8;
+}
+
+// Programs in a bank, 0 unless it holds a complete session in range.
+static uint8_t bank_check(uint8_t b) {
+    const uint8_t *p = session_ee[b];
+    uint16_t end = read_u16(p) + 2;
+    uint16_t crc = 0xFFFF;
+    uint16_t at;
+    uint8_t programs;
+
+    if (end < 3 || end > SESSION_BANK_SIZE - 2) {
+        return 0; // blank or cut short
+    }
+    for (at = 0; at < end; at++) {
+        crc = crc_update(crc, hal_store_read_byte(p + at));
+    }
+    if (crc != read_u16(p + end)) {
+        return 0;
+    }
+
+    programs = hal_store_read_byte(p + 2);
+    if (programs < 1 || programs > SESSION_PROGRAMS) {
+        return 0;
+    }
+    at = 3;
+    for (uint8_t n = 0; n < programs; n++) {
+        uint16_t base_ds = read_u16(p + at);
+        uint8_t steps = hal_store_read_byte(p + at + 2);
+
+        at += 3;
+        if (at > end || base_ds < BASE_MIN_DS || base_ds > BASE_MAX_DS
+            || steps < 1 || steps > PROGRAM_STEPS || at + steps > end) {
+            return 0;
+        }
+        for (; steps; steps--, at++) {
+            int8_t offset = hal_store_read_byte(p + at);
+
+            if (offset > PROGRAM_OFFSET_MAX || offset < -PROGRAM_OFFSET_MAX) {
+                return 0;
+            }
+        }
+    }
+
+    return at == end ? programs : 0;
+}
+
+void session_init(void) {
+    bank = hal_store_read_byte(&bank_ee) & 1;
+    count = bank_check(bank);
+}
+
+uint8_t session_count(void) {
+    return count;
+}
+
+// Copies one program of the active session, returns its step count or
+// 0 if there is no such program.
+uint8_t session_program(uint8_t number, uint16_t *base_ds, int8_t *offsets) {
+    const uint8_t *p = session_ee[bank] + 3;
+    uint8_t steps;
+
+    if (number >= count) {
+        return 0;
+    }
+
+    for (;;) {
+        steps = hal_store_read_byte(p + 2);
+        if (!number--) {
+            break;
+        }
+        p += 3 + steps;
+    }
+
+    *base_ds = read_u16(p);
+    for (uint8_t i = 0; i < steps; i++) {
+        offsets[i] = hal_store_read_byte(p + 3 + i);
+    }
+
+    return steps;
+}
+
+// Reports and goes back to the normal rate once it has been sent.
+static void load_end(const char *message) {
+    loading = 0;
+    put_str_P(message);
+    uart_set_baud(BAUD);
+}
+
+static void load_finish(void) {
+    uint8_t programs = bank_check(bank ^ 1);
+
+    if (!programs) {
+        load_end(PSTR("load: bad session\n"));
+        return;
+    }
+
+    bank ^= 1;
+    count = programs;
+    hal_store_update_byte(&bank_ee, bank);
+    ui_select_program(0);
+
+    put_str_P(PSTR("load ok "));
+    put_u16(programs);
+    load_end(PSTR("\n"));
+}
+
+// Replies at the current rate, the upload follows at baud.
+void session_load(uint32_t baud) {
+    put_str_P(PSTR("load "));
+    put_u16(SESSION_BANK_SIZE);
+    put_char('\n');
+    uart_set_baud(baud);
+
+    loading = 1;
+    load_at = 0;
+    load_size = 0;
+    load_last_ms = timebase_millis();
+}
+
+uint8_t session_loading(void) {
+    return loading;
+}
+
+// Stores what has arrived, as fast as the store takes it.
+void session_poll(void) {
+    uint8_t *p = session_ee[bank ^ 1];
+
+    while (uart_available() && hal_store_ready()) {
+        uint8_t c = uart_getchar(NULL);
+
+        hal_store_update_byte(p + load_at, c);
+        if (load_at < 2) {
+            load_size |= (uint16_t) c << (8 * load_at);
+        }
+        load_at++;
+        load_last_ms = timebase_millis();
+
+        if (load_at == 2) {
+            if (load_size > SESSION_BANK_SIZE - 4) {
+                load_end(PSTR("load: too long\n"));
+                return;
+            }
+            load_size += 4;
+        } else if (load_at > 2 && load_at == load_size) {
+            load_finish();
+            return;
+        }
+        if (load_at % SESSION_CHUNK == 0) {
+            uart_putbyte('.');
+        }
+    }
+
+    if (timebase_millis() - load_last_ms >= SESSION_TIMEOUT_MS) {
+        load_end(PSTR("load: timeout\n"));
+    }
+}
@@ -0,0 +1,32 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <stdint.h>
+
+// Printing session uploaded over the UART, see session.c and
+// tools/session.py.
+
+// Bytes of EEPROM per bank, two banks. Length, programs and CRC must fit.
+#define SESSION_BANK_SIZE 224
+
+// Programs in a session, JOURNAL_PROGRAM() keeps five bits of the number
+#define SESSION_PROGRAMS 32
+
+// Bytes the host sends before waiting for the ack
+#define SESSION_CHUNK 32
+
+// An upload that stops for this long is dropped, in ms
+#define SESSION_TIMEOUT_MS 1000
+
+// Rate of 'load' without an argument
+#define SESSION_BAUD 115200UL
+
+void session_init(void);
+uint8_t session_count(void);
+uint8_t session_program(uint8_t number, uint16_t *base_ds, int8_t *offsets);
+
+void session_load(uint32_t baud);
+uint8_t session_loading(void);
+void session_poll(void);
+
+#endif
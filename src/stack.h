@@ -0,0 +1,14 @@
+#ifndef STACK_H
+#define STACK_H
+
+#include <stdint.h>
+
+// Free RAM between the end of .bss and the stack is painted with this
+// at startup, stack_unused() counts how much of it is still intact.
+#define STACK_CANARY 0xC5
+
+uint16_t stack_static(void);
+uint16_t stack_free(void);
+uint16_t stack_unused(void);
+
+#endif
@@ -0,0 +1,37 @@
+#include "trace.h"
+
+#if TRACE_ENABLE
+
+#include <stdio.h>
+
+#include "uart.h"
+
+trace_entry_t trace_ring[TRACE_SIZE];
+uint8_t trace_head;
+uint8_t trace_frozen;
+
+// Binary dump, oldest entry first: "TR", entry count, then 4 bytes
+// per entry (tick low, tick high, id, arg). Unused entries have id 0.
+// Tracing is held off while the ring goes out.
+void trace_dump(void) {
+    trace_frozen = 1;
+
+    uart_putbyte('T');
+    uart_putbyte('R');
+    uart_putbyte(TRACE_SIZE);
+
+    uint8_t i = trace_head;
+    do {
+        trace_entry_t *entry = &trace_ring[i];
+
+        uart_putbyte(entry->tick);
+        uart_putbyte(entry->tick >> 8);
+        uart_putbyte(entry->id);
+        uart_putbyte(entry->arg);
+        i = (i + 1) & (TRACE_SIZE - 1);
+    } while (i != trace_head);
+
+    trace_frozen = 0;
+}
+
+#endif
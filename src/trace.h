@@ -0,0 +1,67 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+// Event trace for post-mortem timing analysis.
+//
+// TRACE() stores (ms tick, id, arg) into a small RAM ring from ISRs
+// or the main loop. Build with TRACE=0 to compile every call site out.
+// The 'trace' command dumps the ring, tools/tracedump.py renders it.
+
+#ifndef TRACE_ENABLE
+#define TRACE_ENABLE 1
+#endif
+
+// Trace ids, keep tools/tracedump.py in sync
+enum {
+    TR_ENCODER = 1,   // arg: +1 / -1 detent
+    TR_BUTTON,        // arg: event posted
+    TR_RELAY,         // arg: 1 on, 0 off, channel n as n << 1 | on
+    TR_DISPLAY,       // arg: low byte of the displayed number
+    TR_UART_OVERRUN,  // arg: 0 hardware overrun, 1 receive buffer full
+    TR_STATE,         // arg: new UI state
+    TR_DISPLAY_LEVEL, // arg: intensity, 16 shut down
+};
+
+// Entries, must be a power of two
+#define TRACE_SIZE 32
+
+#if TRACE_ENABLE
+
+#include <stdint.h>
+#include "hal.h"
+
+typedef struct {
+    uint16_t tick;
+    uint8_t id;
+    uint8_t arg;
+} trace_entry_t;
+
+extern trace_entry_t trace_ring[TRACE_SIZE];
+extern uint8_t trace_head;
+extern uint8_t trace_frozen;
+extern volatile uint32_t timebase_ms;
+
+static inline void trace(uint8_t id, uint8_t arg) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (!trace_frozen) {
+            trace_entry_t *entry = &trace_ring[trace_head];
+
+            entry->tick = timebase_ms;
+            entry->id = id;
+            entry->arg = arg;
+            trace_head = (trace_head + 1) & (TRACE_SIZE - 1);
+        }
+    }
+}
+
+void trace_dump(void);
+
+#define TRACE(id, arg) trace((id), (arg))
+
+#else
+
+#define TRACE(id, arg) do { } while (0)
+
+#endif
+
+#endif
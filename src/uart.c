@@ -16,47 +16,161 @@
 #include <stdint.h>
 #include <stdio.h>
 
-#include <avr/io.h>
-
+#include "hal.h"
 #include "uart.h"
+#include "exposure.h"
+#include "trace.h"
+
+static volatile char rx_buf[RX_BUFSIZE];
+static volatile uint8_t rx_head;
+static volatile uint8_t rx_tail;
+static volatile uint32_t rx_line_stamp;
+
+static volatile char tx_buf[TX_BUFSIZE];
+static volatile uint8_t tx_head;
+static volatile uint8_t tx_tail;
+
+/*
+ * Initialize the UART to baud Bd, tx/rx, 8N2.
+ */
+void uart_init(uint32_t baud)
+{
+	hal_uart_init(baud);
+}
 
 /*
- * Initialize the UART to 9600 Bd, tx/rx, 8N1.
+ * Change the rate once everything queued so far has gone out at the
+ * old one.
  */
-void uart_init(unsigned int ubrr)
+void uart_set_baud(uint32_t baud)
 {
-	// Set  Baud Rate
-	UBRR0H = (unsigned char)(ubrr >> 8);
-	UBRR0L = (unsigned char)ubrr;
+	while (tx_tail != tx_head)
+		;
+	hal_uart_init(baud);
+}
 
-	// Enable rx and tx
-	UCSR0B |= _BV(RXEN0) | _BV(TXEN0);
+/*
+ * Queue one byte for the transmit interrupt. Only waits when the
+ * transmit buffer is full.
+ */
+static void uart_queue(char c)
+{
+	uint8_t next = (tx_head + 1) & (TX_BUFSIZE - 1);
+
+	while (next == tx_tail)
+		;
+	tx_buf[tx_head] = c;
+	tx_head = next;
 
-	// Set frame format: 8data, 2stop bit
-	UCSR0C = (1 << USBS0) | (3 << UCSZ00);
+	hal_uart_tx_start();
 }
 
 /*
- * Send character c down the UART Tx, wait until tx holding register
- * is empty.
+ * Called from the transmit interrupt, next byte to send or -1 when
+ * the buffer is empty.
  */
-int uart_putchar(char c, FILE *stream)
+int16_t uart_tx_next(void)
 {
+	uint8_t tail = tx_tail;
+	uint8_t c;
+
+	if (tail == tx_head)
+		return -1;
+	c = tx_buf[tail];
+	tx_tail = (tail + 1) & (TX_BUFSIZE - 1);
+
+	return c;
+}
 
+/*
+ * Send character c down the UART Tx through the transmit buffer.
+ */
+int uart_putchar(char c, FILE *stream)
+{
+#if USE_STDIO
 	if (c == '\a')
 	{
 		fputs("*ring*\n", stderr);
 		return 0;
 	}
+#endif
 
 	if (c == '\n')
-		uart_putchar('\r', stream);
-	loop_until_bit_is_set(UCSR0A, UDRE0);
-	UDR0 = c;
+		uart_queue('\r');
+	uart_queue(c);
 
 	return 0;
 }
 
-int uart_getchar(FILE *stream) {
-	return 0;
+/*
+ * Called from the receive interrupt, stores characters into the ring
+ * buffer. Characters arriving while the buffer is full are dropped.
+ */
+void uart_rx_byte(uint8_t c, uint8_t overrun)
+{
+	uint8_t next = rx_head + 1;
+
+	if (overrun)
+		TRACE(TR_UART_OVERRUN, 0);
+
+	if (c == '\n')
+		rx_line_stamp = timebase_stamp();
+
+	if (next == RX_BUFSIZE)
+		next = 0;
+	if (next != rx_tail)
+	{
+		rx_buf[rx_head] = c;
+		rx_head = next;
+	}
+	else
+		TRACE(TR_UART_OVERRUN, 1);
+}
+
+uint32_t uart_line_stamp(void)
+{
+	uint32_t stamp;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		stamp = rx_line_stamp;
+	}
+
+	return stamp;
+}
+
+uint8_t uart_available(void)
+{
+	uint8_t head = rx_head;
+
+	if (head >= rx_tail)
+		return head - rx_tail;
+	return RX_BUFSIZE - rx_tail + head;
+}
+
+/*
+ * Queue one byte to send as it is, with no newline translation.
+ */
+void uart_putbyte(uint8_t b)
+{
+	uart_queue(b);
+}
+
+/*
+ * Take one character from the receive buffer, wait for one if it
+ * is empty.
+ */
+int uart_getchar(FILE *stream)
+{
+	uint8_t tail = rx_tail;
+	char c;
+
+	while (tail == rx_head)
+		;
+	c = rx_buf[tail];
+	if (++tail == RX_BUFSIZE)
+		tail = 0;
+	rx_tail = tail;
+
+	return (unsigned char)c;
 }
\ No newline at end of file
@@ -14,7 +14,12 @@
 /*
  * Perform UART startup initialization.
  */
-void uart_init(unsigned int);
+void uart_init(uint32_t baud);
+
+/*
+ * Switch to another rate after the transmit buffer has drained.
+ */
+void	uart_set_baud(uint32_t baud);
 
 /*
  * Send one character to the UART.
@@ -22,8 +27,33 @@ void uart_init(unsigned int);
 int	uart_putchar(char c, FILE *stream);
 
 /*
- * Size of internal line buffer used by uart_getchar().
+ * Send one byte as is, without newline translation.
+ */
+void	uart_putbyte(uint8_t b);
+
+/*
+ * Size of the transmit buffer drained by the UDRE interrupt, must be
+ * a power of two.
+ */
+#define TX_BUFSIZE 64
+
+/*
+ * Size of internal receive buffer used by uart_getchar().
  */
 #define RX_BUFSIZE 80
 
+/*
+ * Receive one character, waits until one is available.
+ */
 int	uart_getchar(FILE *stream);
+
+/*
+ * Number of received characters waiting in the buffer.
+ */
+uint8_t	uart_available(void);
+
+/*
+ * Timebase stamp of the last '\n' received, taken in the receive
+ * interrupt so it does not depend on when the line gets parsed.
+ */
+uint32_t	uart_line_stamp(void);
@@ -0,0 +1,645 @@
+// UI state machine.
+//
+// Every (state, event) pair has one entry in ui_transitions, which
+// names the next state and one action. Entry, exit and show actions
+// are per-state tables. All tables live in flash and dispatch is a
+// couple of table reads and at most four indirect calls, so the cost
+// does not depend on the mode or on how many modes there are.
+//
+// RUNNING, PAUSED and FOCUS are overlays: entering one remembers the
+// state it came from, and UI_BACK returns there. Returning does not
+// re-run the entry action, only the show action, so whatever the
+// previous mode had computed is kept as is.
+//
+// What an exposure was started from survives a watchdog reset. When
+// the exposure engine restored one, the UI comes back PAUSED over the
+// mode that started it and START finishes the exposure.
+#include "hal.h"
+#include "ui.h"
+#include "event.h"
+#include "exposure.h"
+#include "fstop.h"
+#include "journal.h"
+#include "paper.h"
+#include "session.h"
+#include "max7219.h"
+#include "display.h"
+#include "trace.h"
+
+// Pseudo states for the transition table
+#define UI_STAY 0xFE // no transition, action only
+#define UI_BACK 0xFF // return to the state an overlay was entered from
+
+#define FSTOP_INTERVAL 0.5 // stops between test strip steps and program offsets
+
+#define BASE_STEP_DS 10
+
+#define FOCUS_TIMEOUT_MIN_DS 100
+#define FOCUS_TIMEOUT_MAX_DS 9000
+#define FOCUS_TIMEOUT_STEP_DS 100
+#define FOCUS_TIMEOUT_DEFAULT_DS 600
+
+_Static_assert(PROGRAM_STEPS <= 8, "JOURNAL_PROGRAM() keeps the step in three bits");
+_Static_assert(SESSION_PROGRAMS <= 32, "JOURNAL_PROGRAM() keeps the number in five bits");
+
+typedef struct {
+    uint8_t next;
+    uint8_t action;
+} ui_transition_t;
+
+typedef void (*ui_action_t)(void);
+
+#define BASE_DEFAULT_DS 100
+
+static uint8_t ui_state;
+static uint8_t ui_return_state HAL_NOINIT;
+static uint16_t ui_dispatch_worst;
+
+static uint16_t base_ds HAL_NOINIT;             // base exposure, tenths of a second
+static fstop_t stops;                           // times around the base
+static uint8_t strip_step HAL_NOINIT;
+
+static int8_t program[PROGRAM_STEPS] HAL_NOINIT; // offsets from base, FSTOP_INTERVAL units
+static uint8_t program_len HAL_NOINIT;
+static uint8_t program_step HAL_NOINIT;         // next step to run
+static uint8_t program_number HAL_NOINIT;       // in the session, 0 without one
+static uint8_t edit_step;               // step being edited
+
+static uint16_t focus_elapsed_ds;
+static uint16_t focus_timeout_ds;
+static uint16_t EEMEM focus_timeout_ee = FOCUS_TIMEOUT_DEFAULT_DS;
+static uint8_t focus_timeout_unsaved;   // bytes of it still to store
+
+// Times are corrected for the paper profile last, so the f-stop
+// steps stay on the metered times.
+static uint32_t corrected_ms(int8_t offset) {
+    return paper_correct(paper_get(), fstop_at(&stops, offset) * 1000.0 + 0.5);
+}
+
+static uint32_t program_ms(uint8_t step) {
+    return corrected_ms(program[step]);
+}
+
+// The strip is cumulative, each step adds the difference to the
+// previous one. Step FSTOP_COUNT / 2 brings it to the base time. The
+// corrected totals are differenced, so each patch gets its corrected
+// time.
+static uint32_t strip_ms(uint8_t step) {
+    int8_t offset = step - FSTOP_COUNT / 2;
+    uint32_t previous = step ? corrected_ms(offset - 1) : 0;
+
+    return corrected_ms(offset) - previous;
+}
+
+/* Actions --------------------------------------------------------------- */
+
+static void act_none(void) {
+}
+
+static void act_time_up(void) {
+    if (base_ds <= BASE_MAX_DS - BASE_STEP_DS) {
+        base_ds += BASE_STEP_DS;
+    }
+    fstop_rescale(&stops, base_ds / 10.0);
+    MAX7219_displayNumber(base_ds);
+}
+
+static void act_time_down(void) {
+    if (base_ds >= BASE_MIN_DS + BASE_STEP_DS) {
+        base_ds -= BASE_STEP_DS;
+    }
+    fstop_rescale(&stops, base_ds / 10.0);
+    MAX7219_displayNumber(base_ds);
+}
+
+// The encoder moves the whole test strip by one interval, the base
+// follows to the nearest tenth. The table is scaled back to that
+// tenth, so the times exposed stay those of the base on the display
+// and the shift's one new entry is all that was computed.
+static void strip_shift(int8_t direction) {
+    uint16_t ds;
+
+    fstop_shift(&stops, direction);
+    ds = fstop_base(&stops) * 10.0 + 0.5;
+    if (ds < BASE_MIN_DS || ds > BASE_MAX_DS) {
+        fstop_shift(&stops, -direction);
+    } else {
+        base_ds = ds;
+        fstop_rescale(&stops, ds / 10.0);
+    }
+    strip_step = 0;
+    MAX7219_displayNumber(base_ds);
+}
+
+static void act_strip_up(void) {
+    strip_shift(1);
+}
+
+static void act_strip_down(void) {
+    strip_shift(-1);
+}
+
+static void act_run_program(void) {
+    exposure_start(program_ms(program_step));
+}
+
+static void act_run_strip(void) {
+    exposure_start(strip_ms(strip_step));
+}
+
+static void act_resume(void) {
+    exposure_resume();
+}
+
+static void act_abort(void) {
+    exposure_abort();
+}
+
+// Copies a program of the uploaded session over the current one.
+static uint8_t program_load(uint8_t number) {
+    uint16_t ds;
+    uint8_t steps = session_program(number, &ds, program);
+
+    if (!steps) {
+        return 0;
+    }
+
+    base_ds = ds;
+    program_len = steps;
+    program_step = 0;
+    program_number = number;
+    fstop_set_base(&stops, base_ds / 10.0);
+    return 1;
+}
+
+// Exposure finished, move on to the next step of whatever started it.
+// Print exposures go to the journal. After the last step of a session
+// program the next one is loaded, after the last program the first.
+static void act_run_done(void) {
+    display_cue();
+    if (ui_return_state == UI_TEST_STRIP) {
+        if (++strip_step == FSTOP_COUNT) {
+            strip_step = 0;
+        }
+    } else {
+        journal_add(base_ds, program[program_step],
+                    JOURNAL_PROGRAM(program_number, program_step), exposure_get_driven());
+        if (++program_step >= program_len) {
+            program_step = 0;
+            if (session_count() && !program_load(program_number + 1)) {
+                program_load(0);
+            }
+        }
+    }
+}
+
+static void act_show_remaining(void) {
+    MAX7219_displayNumber((exposure_remaining() + 99) / 100);
+}
+
+static void act_step_up(void) {
+    if (program[edit_step] < PROGRAM_OFFSET_MAX) {
+        program[edit_step]++;
+    }
+    MAX7219_displayNumber(program[edit_step] * (int) (FSTOP_INTERVAL * 10));
+}
+
+static void act_step_down(void) {
+    if (program[edit_step] > -PROGRAM_OFFSET_MAX) {
+        program[edit_step]--;
+    }
+    MAX7219_displayNumber(program[edit_step] * (int) (FSTOP_INTERVAL * 10));
+}
+
+static void act_step_next(void) {
+    if (edit_step < PROGRAM_STEPS - 1) {
+        edit_step++;
+    }
+    if (edit_step >= program_len) {
+        program_len = edit_step + 1;
+        program[edit_step] = program[edit_step - 1];
+    }
+    MAX7219_displayNumber(program[edit_step] * (int) (FSTOP_INTERVAL * 10));
+}
+
+// Profile number shown as a whole number
+static void act_paper_next(void) {
+    paper_select(paper_get() < PAPER_COUNT - 1 ? paper_get() + 1 : 0);
+    MAX7219_displayNumber(paper_get() * 10);
+}
+
+static void act_paper_prev(void) {
+    paper_select(paper_get() ? paper_get() - 1 : PAPER_COUNT - 1);
+    MAX7219_displayNumber(paper_get() * 10);
+}
+
+// One EV_TICK per tenth of a second while the lamp is on.
+static void act_focus_tick(void) {
+    MAX7219_displayNumber(++focus_elapsed_ds);
+    if (focus_elapsed_ds == focus_timeout_ds) {
+        event_put(EV_TIMEOUT);
+    }
+}
+
+// The encoder sets the focus timeout while focusing, the
+// display shows the new timeout until the next tick.
+static void act_focus_longer(void) {
+    if (focus_timeout_ds <= FOCUS_TIMEOUT_MAX_DS - FOCUS_TIMEOUT_STEP_DS) {
+        focus_timeout_ds += FOCUS_TIMEOUT_STEP_DS;
+    }
+    MAX7219_displayNumber(focus_timeout_ds);
+}
+
+static void act_focus_shorter(void) {
+    if (focus_timeout_ds >= FOCUS_TIMEOUT_MIN_DS + FOCUS_TIMEOUT_STEP_DS) {
+        focus_timeout_ds -= FOCUS_TIMEOUT_STEP_DS;
+    }
+    if (focus_elapsed_ds >= focus_timeout_ds) {
+        event_put(EV_TIMEOUT);
+    }
+    MAX7219_displayNumber(focus_timeout_ds);
+}
+
+enum {
+    A_NONE = 0,
+    A_TIME_UP,
+    A_TIME_DOWN,
+    A_RUN_PROGRAM,
+    A_RUN_STRIP,
+    A_RESUME,
+    A_ABORT,
+    A_RUN_DONE,
+    A_SHOW_REMAINING,
+    A_STEP_UP,
+    A_STEP_DOWN,
+    A_STEP_NEXT,
+    A_FOCUS_TICK,
+    A_FOCUS_LONGER,
+    A_FOCUS_SHORTER,
+    A_STRIP_UP,
+    A_STRIP_DOWN,
+    A_PAPER_NEXT,
+    A_PAPER_PREV,
+};
+
+static const ui_action_t ui_actions[] PROGMEM = {
+    [A_NONE]           = act_none,
+    [A_TIME_UP]        = act_time_up,
+    [A_TIME_DOWN]      = act_time_down,
+    [A_RUN_PROGRAM]    = act_run_program,
+    [A_RUN_STRIP]      = act_run_strip,
+    [A_RESUME]         = act_resume,
+    [A_ABORT]          = act_abort,
+    [A_RUN_DONE]       = act_run_done,
+    [A_SHOW_REMAINING] = act_show_remaining,
+    [A_STEP_UP]        = act_step_up,
+    [A_STEP_DOWN]      = act_step_down,
+    [A_STEP_NEXT]      = act_step_next,
+    [A_FOCUS_TICK]     = act_focus_tick,
+    [A_FOCUS_LONGER]   = act_focus_longer,
+    [A_FOCUS_SHORTER]  = act_focus_shorter,
+    [A_STRIP_UP]       = act_strip_up,
+    [A_STRIP_DOWN]     = act_strip_down,
+    [A_PAPER_NEXT]     = act_paper_next,
+    [A_PAPER_PREV]     = act_paper_prev,
+};
+
+/* Entry, exit and show -------------------------------------------------- */
+
+static void enter_paused(void) {
+    exposure_pause();
+}
+
+static void enter_focus(void) {
+    relay_on();
+    focus_elapsed_ds = 0;
+}
+
+// Relay first, the EEPROM write only happens if the timeout changed.
+// The timeout is stored later by ui_poll(), a store write would hold
+// up the dispatch for milliseconds.
+static void exit_focus(void) {
+    relay_off();
+    focus_timeout_unsaved = sizeof(focus_timeout_ds);
+}
+
+static void enter_test_strip(void) {
+    strip_step = 0;
+}
+
+static void enter_program_edit(void) {
+    edit_step = 0;
+}
+
+// Editing ends at the step the user left on.
+static void exit_program_edit(void) {
+    program_len = edit_step + 1;
+    program_step = 0;
+}
+
+// Saved when leaving, like the focus timeout.
+static void exit_paper(void) {
+    paper_save();
+}
+
+static void show_idle(void) {
+    MAX7219_displayNumber(program_ms(program_step) / 100);
+}
+
+static void show_base(void) {
+    MAX7219_displayNumber(base_ds);
+}
+
+static void show_focus(void) {
+    MAX7219_displayNumber(focus_elapsed_ds);
+}
+
+static void show_strip(void) {
+    MAX7219_displayNumber(strip_ms(strip_step) / 100);
+}
+
+static void show_program(void) {
+    MAX7219_displayNumber(program[edit_step] * (int) (FSTOP_INTERVAL * 10));
+}
+
+static void show_paper(void) {
+    MAX7219_displayNumber(paper_get() * 10);
+}
+
+static const ui_action_t ui_entry[UI_STATE_COUNT] PROGMEM = {
+    [UI_IDLE]         = act_none,
+    [UI_FOCUS]        = enter_focus,
+    [UI_SET_TIME]     = act_none,
+    [UI_RUNNING]      = act_none,
+    [UI_PAUSED]       = enter_paused,
+    [UI_TEST_STRIP]   = enter_test_strip,
+    [UI_PROGRAM_EDIT] = enter_program_edit,
+    [UI_PAPER]        = act_none,
+};
+
+static const ui_action_t ui_exit[UI_STATE_COUNT] PROGMEM = {
+    [UI_IDLE]         = act_none,
+    [UI_FOCUS]        = exit_focus,
+    [UI_SET_TIME]     = act_none,
+    [UI_RUNNING]      = act_none,
+    [UI_PAUSED]       = act_none,
+    [UI_TEST_STRIP]   = act_none,
+    [UI_PROGRAM_EDIT] = exit_program_edit,
+    [UI_PAPER]        = exit_paper,
+};
+
+static const ui_action_t ui_show[UI_STATE_COUNT] PROGMEM = {
+    [UI_IDLE]         = show_idle,
+    [UI_FOCUS]        = show_focus,
+    [UI_SET_TIME]     = show_base,
+    [UI_RUNNING]      = act_show_remaining,
+    [UI_PAUSED]       = act_show_remaining,
+    [UI_TEST_STRIP]   = show_strip,
+    [UI_PROGRAM_EDIT] = show_program,
+    [UI_PAPER]        = show_paper,
+};
+
+// Overlay states remember where they were entered from.
+static const uint8_t ui_overlay[UI_STATE_COUNT] PROGMEM = {
+    [UI_FOCUS]   = 1,
+    [UI_RUNNING] = 1,
+    [UI_PAUSED]  = 1,
+};
+
+/* Transition table ------------------------------------------------------ */
+
+#define T(next, action) { next, action }
+#define NOTHING T(UI_STAY, A_NONE)
+
+static const ui_transition_t ui_transitions[UI_STATE_COUNT][EV_COUNT] PROGMEM = {
+    [UI_IDLE] = {
+        [EV_NONE]       = NOTHING,
+        [EV_ENC_CW]     = T(UI_SET_TIME, A_TIME_UP),
+        [EV_ENC_CCW]    = T(UI_SET_TIME, A_TIME_DOWN),
+        [EV_ENC_CLICK]  = T(UI_TEST_STRIP, A_NONE),
+        [EV_START]      = T(UI_RUNNING, A_RUN_PROGRAM),
+        [EV_FOCUS]      = T(UI_FOCUS, A_NONE),
+        [EV_TICK]       = NOTHING,
+        [EV_DONE]       = NOTHING,
+        [EV_TIMEOUT]    = NOTHING,
+        [EV_MODE_PRINT] = NOTHING,
+        [EV_MODE_TEST]  = T(UI_TEST_STRIP, A_NONE),
+    },
+    [UI_FOCUS] = {
+        [EV_NONE]       = NOTHING,
+        [EV_ENC_CW]     = T(UI_STAY, A_FOCUS_LONGER),
+        [EV_ENC_CCW]    = T(UI_STAY, A_FOCUS_SHORTER),
+        [EV_ENC_CLICK]  = T(UI_BACK, A_NONE),
+        [EV_START]      = NOTHING,
+        [EV_FOCUS]      = T(UI_BACK, A_NONE),
+        [EV_TICK]       = T(UI_STAY, A_FOCUS_TICK),
+        [EV_DONE]       = NOTHING,
+        [EV_TIMEOUT]    = T(UI_BACK, A_NONE),
+        [EV_MODE_PRINT] = NOTHING,
+        [EV_MODE_TEST]  = NOTHING,
+    },
+    [UI_SET_TIME] = {
+        [EV_NONE]       = NOTHING,
+        [EV_ENC_CW]     = T(UI_STAY, A_TIME_UP),
+        [EV_ENC_CCW]    = T(UI_STAY, A_TIME_DOWN),
+        [EV_ENC_CLICK]  = T(UI_IDLE, A_NONE),
+        [EV_START]      = T(UI_RUNNING, A_RUN_PROGRAM),
+        [EV_FOCUS]      = T(UI_FOCUS, A_NONE),
+        [EV_TICK]       = NOTHING,
+        [EV_DONE]       = NOTHING,
+        [EV_TIMEOUT]    = NOTHING,
+        [EV_MODE_PRINT] = NOTHING,
+        [EV_MODE_TEST]  = T(UI_TEST_STRIP, A_NONE),
+    },
+    [UI_RUNNING] = {
+        [EV_NONE]       = NOTHING,
+        [EV_ENC_CW]     = NOTHING,
+        [EV_ENC_CCW]    = NOTHING,
+        [EV_ENC_CLICK]  = T(UI_PAUSED, A_NONE),
+        [EV_START]      = T(UI_PAUSED, A_NONE),
+        [EV_FOCUS]      = NOTHING,
+        [EV_TICK]       = T(UI_STAY, A_SHOW_REMAINING),
+        [EV_DONE]       = T(UI_BACK, A_RUN_DONE),
+        [EV_TIMEOUT]    = NOTHING,
+        [EV_MODE_PRINT] = NOTHING,
+        [EV_MODE_TEST]  = NOTHING,
+    },
+    [UI_PAUSED] = {
+        [EV_NONE]       = NOTHING,
+        [EV_ENC_CW]     = NOTHING,
+        [EV_ENC_CCW]    = NOTHING,
+        [EV_ENC_CLICK]  = T(UI_BACK, A_ABORT),
+        [EV_START]      = T(UI_RUNNING, A_RESUME),
+        [EV_FOCUS]      = NOTHING,
+        [EV_TICK]       = NOTHING,
+        [EV_DONE]       = T(UI_BACK, A_RUN_DONE), // finished before the pause got in
+        [EV_TIMEOUT]    = NOTHING,
+        [EV_MODE_PRINT] = NOTHING,
+        [EV_MODE_TEST]  = NOTHING,
+    },
+    [UI_TEST_STRIP] = {
+        [EV_NONE]       = NOTHING,
+        [EV_ENC_CW]     = T(UI_STAY, A_STRIP_UP),
+        [EV_ENC_CCW]    = T(UI_STAY, A_STRIP_DOWN),
+        [EV_ENC_CLICK]  = T(UI_PROGRAM_EDIT, A_NONE),
+        [EV_START]      = T(UI_RUNNING, A_RUN_STRIP),
+        [EV_FOCUS]      = T(UI_FOCUS, A_NONE),
+        [EV_TICK]       = NOTHING,
+        [EV_DONE]       = NOTHING,
+        [EV_TIMEOUT]    = NOTHING,
+        [EV_MODE_PRINT] = T(UI_IDLE, A_NONE),
+        [EV_MODE_TEST]  = NOTHING,
+    },
+    [UI_PROGRAM_EDIT] = {
+        [EV_NONE]       = NOTHING,
+        [EV_ENC_CW]     = T(UI_STAY, A_STEP_UP),
+        [EV_ENC_CCW]    = T(UI_STAY, A_STEP_DOWN),
+        [EV_ENC_CLICK]  = T(UI_PAPER, A_NONE),
+        [EV_START]      = T(UI_STAY, A_STEP_NEXT),
+        [EV_FOCUS]      = T(UI_FOCUS, A_NONE),
+        [EV_TICK]       = NOTHING,
+        [EV_DONE]       = NOTHING,
+        [EV_TIMEOUT]    = NOTHING,
+        [EV_MODE_PRINT] = NOTHING,
+        [EV_MODE_TEST]  = NOTHING,
+    },
+    [UI_PAPER] = {
+        [EV_NONE]       = NOTHING,
+        [EV_ENC_CW]     = T(UI_STAY, A_PAPER_NEXT),
+        [EV_ENC_CCW]    = T(UI_STAY, A_PAPER_PREV),
+        [EV_ENC_CLICK]  = T(UI_IDLE, A_NONE),
+        [EV_START]      = NOTHING,
+        [EV_FOCUS]      = T(UI_FOCUS, A_NONE),
+        [EV_TICK]       = NOTHING,
+        [EV_DONE]       = NOTHING,
+        [EV_TIMEOUT]    = NOTHING,
+        [EV_MODE_PRINT] = NOTHING,
+        [EV_MODE_TEST]  = NOTHING,
+    },
+};
+
+static inline void ui_call(const ui_action_t *table, uint8_t index) {
+    ((ui_action_t) pgm_read_ptr(&table[index]))();
+}
+
+// The noinit settings as a watchdog reset left them, if they are
+// still in range. The reset may have come from a stray write.
+static uint8_t ui_restorable(void) {
+    if (ui_return_state != UI_IDLE && ui_return_state != UI_SET_TIME
+        && ui_return_state != UI_TEST_STRIP) {
+        return 0;
+    }
+    if (base_ds < BASE_MIN_DS || base_ds > BASE_MAX_DS || strip_step >= FSTOP_COUNT
+        || program_len < 1 || program_len > PROGRAM_STEPS || program_step >= program_len
+        || program_number >= SESSION_PROGRAMS) {
+        return 0;
+    }
+    for (uint8_t i = 0; i < PROGRAM_STEPS; i++) {
+        if (program[i] > PROGRAM_OFFSET_MAX || program[i] < -PROGRAM_OFFSET_MAX) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+void ui_init(void) {
+    focus_timeout_ds = hal_store_read_word(&focus_timeout_ee);
+    if (focus_timeout_ds < FOCUS_TIMEOUT_MIN_DS || focus_timeout_ds > FOCUS_TIMEOUT_MAX_DS) {
+        focus_timeout_ds = FOCUS_TIMEOUT_DEFAULT_DS; // blank EEPROM
+    }
+    paper_init();
+    session_init();
+
+    ui_state = UI_IDLE;
+    if (exposure_interrupted() && ui_restorable()) {
+        ui_state = UI_PAUSED;
+    } else {
+        if (exposure_interrupted()) {
+            exposure_abort(); // nothing to return to
+        }
+        ui_return_state = UI_IDLE;
+        base_ds = BASE_DEFAULT_DS;
+        strip_step = 0;
+        for (uint8_t i = 0; i < PROGRAM_STEPS; i++) {
+            program[i] = 0;
+        }
+        program_len = 1;
+        program_step = 0;
+        program_number = 0;
+    }
+
+    fstop_init(&stops, base_ds / 10.0, FSTOP_INTERVAL);
+    if (ui_state == UI_IDLE) {
+        program_load(0); // if a session was uploaded
+    }
+
+    ui_call(ui_show, ui_state);
+}
+
+void ui_dispatch(uint8_t event) {
+    uint16_t start = timebase_now();
+    const ui_transition_t *t = &ui_transitions[ui_state][event];
+    uint8_t next = pgm_read_byte(&t->next);
+    uint8_t resume = (next == UI_BACK);
+
+    if (resume) {
+        next = ui_return_state;
+    }
+
+    if (next == UI_STAY) {
+        ui_call(ui_actions, pgm_read_byte(&t->action));
+    } else {
+        ui_call(ui_exit, ui_state);
+        ui_call(ui_actions, pgm_read_byte(&t->action));
+
+        if (pgm_read_byte(&ui_overlay[next]) && !pgm_read_byte(&ui_overlay[ui_state])) {
+            ui_return_state = ui_state;
+        }
+        ui_state = next;
+        TRACE(TR_STATE, next);
+
+        if (!resume) {
+            ui_call(ui_entry, next);
+        }
+        ui_call(ui_show, next);
+    }
+
+    uint16_t elapsed = timebase_now() - start;
+    if (elapsed > ui_dispatch_worst) {
+        ui_dispatch_worst = elapsed;
+    }
+}
+
+// From the main loop when it is idle: stores a changed focus timeout,
+// a byte per ready store, little endian as the word reads back.
+void ui_poll(void) {
+    if (focus_timeout_unsaved && hal_store_ready()) {
+        uint8_t i = --focus_timeout_unsaved;
+
+        hal_store_update_byte((uint8_t *) &focus_timeout_ee + i, focus_timeout_ds >> (8 * i));
+    }
+}
+
+uint8_t ui_get_state(void) {
+    return ui_state;
+}
+
+// A program of the uploaded session, only while idle. The knob edits
+// the loaded copy, the session itself stays as uploaded.
+uint8_t ui_select_program(uint8_t number) {
+    if (ui_state != UI_IDLE || !program_load(number)) {
+        return 0;
+    }
+
+    ui_call(ui_show, ui_state);
+    return 1;
+}
+
+uint8_t ui_get_program(void) {
+    return program_number;
+}
+
+uint16_t ui_get_dispatch_worst(void) {
+    return ui_dispatch_worst;
+}
@@ -0,0 +1,38 @@
+#ifndef UI_H
+#define UI_H
+
+#include <stdint.h>
+
+// UI modes. Values index the tables in ui.c, keep them dense.
+enum {
+    UI_IDLE = 0,
+    UI_FOCUS,
+    UI_SET_TIME,
+    UI_RUNNING,
+    UI_PAUSED,
+    UI_TEST_STRIP,
+    UI_PROGRAM_EDIT,
+    UI_PAPER,
+    UI_STATE_COUNT
+};
+
+// Maximum number of exposures in a program
+#define PROGRAM_STEPS 8
+
+// Base time range, tenths of a second
+#define BASE_MIN_DS 10
+#define BASE_MAX_DS 9990
+
+#define PROGRAM_OFFSET_MAX 12 // +-6 stops in FSTOP_INTERVAL units
+
+void ui_init(void);
+void ui_dispatch(uint8_t event);
+void ui_poll(void);
+uint8_t ui_get_state(void);
+uint8_t ui_select_program(uint8_t number);
+uint8_t ui_get_program(void);
+
+// Worst-case ui_dispatch() time seen so far, in Timer1 counts.
+uint16_t ui_get_dispatch_worst(void);
+
+#endif
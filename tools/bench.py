@@ -0,0 +1,142 @@
+#!/usr/bin/env python3
+"""Run the host microbenchmarks and add AVR cycle estimates.
+
+    tools/bench.py src/timer_bench                      host numbers
+    tools/bench.py src/timer_bench --elf src/src.elf    plus AVR estimates
+    tools/bench.py src/timer_bench --baseline old.json  fail on regressions
+
+Writes one JSON object to stdout (or --save), a summary table to
+stderr. The AVR figures are static: every instruction of the function
+counted once at its worst-case cycle count, taken branches included,
+loops and callees not followed. They move when the code generated for
+a path changes, which is what a regression check needs, but they are
+not a cycle count of a run. The image is also checked for malloc.
+"""
+import argparse
+import json
+import re
+import shutil
+import subprocess
+import sys
+
+# Worst-case cycles on the AVR core (atmega328p), mnemonic -> cycles
+CYCLES = {
+    "call": 4, "ret": 4, "reti": 4,
+    "rcall": 3, "icall": 3, "jmp": 3, "lpm": 3, "elpm": 3,
+    "rjmp": 2, "ijmp": 2, "ld": 2, "ldd": 2, "st": 2, "std": 2, "lds": 2, "sts": 2,
+    "push": 2, "pop": 2, "adiw": 2, "sbiw": 2, "sbi": 2, "cbi": 2,
+    "mul": 2, "muls": 2, "mulsu": 2, "fmul": 2, "fmuls": 2, "fmulsu": 2,
+    "cpse": 3, "sbrc": 3, "sbrs": 3, "sbic": 3, "sbis": 3,
+}
+BRANCH = re.compile(r"^br[a-z]+$")
+
+ALLOCATORS = ("malloc", "calloc", "realloc", "free")
+
+
+def instruction_cycles(mnemonic):
+    if mnemonic in CYCLES:
+        return CYCLES[mnemonic]
+    if BRANCH.match(mnemonic):
+        return 2
+    return 1
+
+
+def disassemble(elf):
+    """{function: [mnemonic, ...]} from avr-objdump -d."""
+    text = subprocess.run(["avr-objdump", "-d", elf], check=True,
+                          capture_output=True, text=True).stdout
+    functions = {}
+    current = None
+    for line in text.splitlines():
+        header = re.match(r"^[0-9a-f]+ <([^>]+)>:$", line)
+        if header:
+            current = functions.setdefault(header.group(1), [])
+            continue
+        fields = line.split("\t")
+        if current is not None and len(fields) >= 3 and fields[0].strip().endswith(":"):
+            current.append(fields[2].split()[0])
+    return functions
+
+
+def symbols(elf):
+    text = subprocess.run(["avr-nm", elf], check=True, capture_output=True, text=True).stdout
+    return {line.split()[-1] for line in text.splitlines() if line.split()}
+
+
+def avr_estimates(elf, names):
+    functions = disassemble(elf)
+    estimates = {}
+    for name in names:
+        body = functions.get(name)
+        if body is None:
+            estimates[name] = None  # inlined or not linked in
+        else:
+            estimates[name] = {"instructions": len(body),
+                               "cycles": sum(instruction_cycles(m) for m in body)}
+    linked = symbols(elf)
+    return estimates, [a for a in ALLOCATORS if a in linked]
+
+
+def compare(result, baseline, tolerance):
+    regressions = []
+    old_cases = {c["name"]: c for c in baseline.get("cases", [])}
+    for case in result["cases"]:
+        old = old_cases.get(case["name"])
+        if old and case["ns_per_op"] > old["ns_per_op"] * (1 + tolerance / 100.0):
+            regressions.append("%s: %.2f ns/op, was %.2f" % (case["name"], case["ns_per_op"], old["ns_per_op"]))
+
+    old_avr = baseline.get("avr", {}).get("functions", {})
+    for name, est in result.get("avr", {}).get("functions", {}).items():
+        old = old_avr.get(name)
+        if est and old and est["cycles"] > old["cycles"]:
+            regressions.append("%s: %d AVR cycles, was %d" % (name, est["cycles"], old["cycles"]))
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("bench", help="the timer_bench binary")
+    parser.add_argument("--elf", help="AVR image for cycle estimates")
+    parser.add_argument("--baseline", help="earlier JSON output to compare against")
+    parser.add_argument("--tolerance", type=float, default=20.0, help="host slowdown allowed, percent")
+    parser.add_argument("--save", help="write the JSON here instead of stdout")
+    args = parser.parse_args()
+
+    run = subprocess.run([args.bench], capture_output=True, text=True)
+    result = json.loads(run.stdout)
+    failures = ["%s allocates" % c["name"] for c in result["cases"] if c["allocs"]]
+
+    if args.elf:
+        if shutil.which("avr-objdump") and shutil.which("avr-nm"):
+            names = sorted({c["symbol"] for c in result["cases"]})
+            functions, allocators = avr_estimates(args.elf, names)
+            result["avr"] = {"elf": args.elf, "functions": functions, "allocators": allocators}
+            failures += ["AVR image links %s" % a for a in allocators]
+        else:
+            print("avr-objdump not found, no AVR estimates", file=sys.stderr)
+
+    if args.baseline:
+        with open(args.baseline) as f:
+            failures += ["regression " + r for r in compare(result, json.load(f), args.tolerance)]
+
+    text = json.dumps(result, indent=2) + "\n"
+    if args.save:
+        with open(args.save, "w") as f:
+            f.write(text)
+    else:
+        sys.stdout.write(text)
+
+    avr = result.get("avr", {}).get("functions", {})
+    print("%-26s %10s %6s %10s" % ("case", "ns/op", "allocs", "AVR cycles"), file=sys.stderr)
+    for case in result["cases"]:
+        est = avr.get(case["symbol"])
+        print("%-26s %10.2f %6d %10s" % (case["name"], case["ns_per_op"], case["allocs"],
+                                         est["cycles"] if est else "-"), file=sys.stderr)
+
+    for failure in failures:
+        print("bench: " + failure, file=sys.stderr)
+    return 1 if failures or run.returncode else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
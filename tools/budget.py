@@ -0,0 +1,99 @@
+#!/usr/bin/env python3
+"""Flash and RAM budget for the firmware image.
+
+Combines the section sizes from 'avr-size -A' with the per-function
+stack frames gcc writes to *.su files (-fstack-usage) into one table,
+and exits non-zero when a limit is exceeded.
+
+    avr-size -A src.elf | tools/budget.py --flash 32256 --ram 2048 \\
+        --stack-reserve 384 --frame 96 *.su
+
+The .su files carry no call graph, so the stack check is the
+configured reserve plus the largest ISR frame against what .data and
+.bss leave free, and every single frame against --frame. Use the
+'mem' command on the board to see the real high-water mark and tune
+the reserve from it.
+"""
+import argparse
+import sys
+
+FLASH_SECTIONS = (".text", ".data")
+RAM_SECTIONS = (".data", ".bss", ".noinit")
+
+
+def read_sections(lines):
+    sizes = {}
+    for line in lines:
+        fields = line.split()
+        if len(fields) >= 2 and fields[0].startswith(".") and fields[1].isdigit():
+            sizes[fields[0]] = int(fields[1])
+    return sizes
+
+
+def read_frames(paths):
+    frames = []
+    for path in paths:
+        with open(path) as f:
+            for line in f:
+                location, size, kind = line.rstrip("\n").split("\t")
+                name = location.rsplit(":", 1)[-1]
+                frames.append((int(size), name, kind, location.split(":")[0]))
+    frames.sort(reverse=True)
+    return frames
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("su", nargs="*", help="stack usage files")
+    parser.add_argument("--flash", type=int, required=True, help="flash limit, bytes")
+    parser.add_argument("--ram", type=int, required=True, help="RAM size, bytes")
+    parser.add_argument("--stack-reserve", type=int, required=True, help="RAM kept for the stack")
+    parser.add_argument("--frame", type=int, required=True, help="largest allowed single frame")
+    parser.add_argument("--top", type=int, default=10, help="frames to list")
+    args = parser.parse_args()
+
+    sizes = read_sections(sys.stdin)
+    frames = read_frames(args.su)
+
+    flash = sum(sizes.get(s, 0) for s in FLASH_SECTIONS)
+    static_ram = sum(sizes.get(s, 0) for s in RAM_SECTIONS)
+    isr_frame = max((f[0] for f in frames if f[1].startswith("__vector")), default=0)
+    stack = args.stack_reserve + isr_frame
+
+    failures = []
+    rows = [
+        ("flash (.text + .data)", flash, args.flash),
+        ("static RAM (.data + .bss + .noinit)", static_ram, None),
+        ("stack reserve + largest ISR frame", stack, None),
+        ("RAM total", static_ram + stack, args.ram),
+    ]
+
+    print("%-38s %8s %8s %6s" % ("budget", "used", "limit", "%"))
+    for name, used, limit in rows:
+        if limit:
+            print("%-38s %8d %8d %5.1f%%" % (name, used, limit, 100.0 * used / limit))
+            if used > limit:
+                failures.append("%s: %d > %d" % (name, used, limit))
+        else:
+            print("%-38s %8d" % (name, used))
+
+    print()
+    print("%-38s %8s  %s" % ("largest stack frames", "bytes", "kind"))
+    for size, name, kind, source in frames[:args.top]:
+        print("%-38s %8d  %s" % ("%s (%s)" % (name, source), size, kind))
+    for size, name, kind, source in frames:
+        if size > args.frame:
+            failures.append("frame %s: %d > %d" % (name, size, args.frame))
+        if kind == "dynamic":
+            failures.append("frame %s is %s, cannot be bounded" % (name, kind))
+
+    if failures:
+        print()
+        for failure in failures:
+            print("budget exceeded: " + failure, file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
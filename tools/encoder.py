@@ -0,0 +1,96 @@
+#!/usr/bin/env python3
+"""Record the encoder lines on the board and replay them on the host.
+
+    tools/encoder.py /dev/ttyUSB0 --save turns.bin    record while you turn
+    tools/encoder.py --file turns.bin                 show a saved capture
+    tools/encoder.py --file turns.bin --replay src/timer_encoder
+
+The board records 512 polls of A/B after 'enc' (about 2 s at the 4 ms
+poll), turn the knob meanwhile. The capture format mirrors
+rotary_capture_dump() in src/rotary.c; --replay feeds it to the host
+build of the decoder, which must count what the board counted.
+"""
+import argparse
+import struct
+import subprocess
+import sys
+import time
+
+
+def parse(data):
+    start = data.find(b"EN")
+    if start < 0 or len(data) < start + 8:
+        raise ValueError("no capture header")
+    samples, period_us, counted = struct.unpack_from("<HHh", data, start + 2)
+    body = data[start + 8:start + 8 + (samples + 3) // 4]
+    if len(body) < (samples + 3) // 4:
+        raise ValueError("short capture, %d of %d samples" % (4 * len(body), samples))
+    levels = [(body[i // 4] >> (2 * (i % 4))) & 3 for i in range(samples)]
+    return period_us, counted, levels
+
+
+def render(period_us, counted, levels, out=sys.stdout):
+    """One line per change of the lines, A and B as 1 released, 0 pressed."""
+    out.write("%d samples at %d us, board counted %+d\n" % (len(levels), period_us, counted))
+    previous = None
+    for i, ab in enumerate(levels):
+        if ab != previous:
+            out.write("%8.1f ms  A %d  B %d\n" % (i * period_us / 1000.0, ab & 1, ab >> 1))
+            previous = ab
+
+
+def fetch(port_name, baud):
+    import serial
+
+    with serial.Serial(port_name, baud, timeout=2) as port:
+        port.reset_input_buffer()
+        port.write(b"enc\n")
+        answer = port.readline()
+        if not answer.startswith(b"enc"):
+            raise ValueError("no answer: %r" % answer)
+        sys.stderr.write("recording, turn the knob\n")
+        time.sleep(2.5)
+
+        port.reset_input_buffer()
+        port.write(b"enc dump\n")
+        data = port.read_until(b"EN")
+        if not data.endswith(b"EN"):
+            raise ValueError("no capture")
+        header = port.read(6)
+        samples = struct.unpack_from("<H", header)[0]
+        return data + header + port.read((samples + 3) // 4)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("port", nargs="?")
+    parser.add_argument("--baud", type=int, default=9600)
+    parser.add_argument("--file")
+    parser.add_argument("--save", help="also write the raw capture here")
+    parser.add_argument("--replay", metavar="HARNESS", help="replay through this timer_encoder")
+    args = parser.parse_args()
+
+    if args.file:
+        with open(args.file, "rb") as f:
+            data = f.read()
+    elif args.port:
+        data = fetch(args.port, args.baud)
+    else:
+        parser.error("need a port or --file")
+
+    if args.save:
+        with open(args.save, "wb") as f:
+            f.write(data)
+
+    render(*parse(data))
+
+    if args.replay:
+        path = args.file or args.save
+        if not path:
+            parser.error("--replay needs --file or --save")
+        return subprocess.run([args.replay, "--replay", path]).returncode
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,175 @@
+#!/usr/bin/env python3
+"""Fetch and decode the exposure journal.
+
+    tools/journal.py /dev/ttyUSB0       ask the board for a dump
+    tools/journal.py --file dump.bin    decode a saved dump
+    tools/journal.py --csv ...          one line per exposure, comma separated
+
+The record format and the ring layout mirror src/journal.c.
+"""
+import argparse
+import sys
+
+J_KEY = 0x40
+J_BASE = 0x20
+J_PROG = 0x10
+J_LEN = 0x0F
+
+FSTOP_INTERVAL = 0.5  # stops per offset unit, src/ui.c
+
+
+def is_free(header):
+    return header == 0xFF or header & J_LEN == 0
+
+
+def record_end(region, pos):
+    return min(pos + 1 + (region[pos] & J_LEN), len(region))
+
+
+def skip_free(region, pos):
+    while pos < len(region) and is_free(region[pos]):
+        pos += 1
+    return pos
+
+
+def records(region):
+    """Raw records oldest first: the previous lap from tail, then 0 to head."""
+    pos = 0
+    newest = []
+    while pos < len(region) and not is_free(region[pos]):
+        end = record_end(region, pos)
+        newest.append(region[pos:end])
+        pos = end
+
+    older = []
+    pos = skip_free(region, pos)
+    while pos < len(region) and not is_free(region[pos]):
+        end = record_end(region, pos)
+        older.append(region[pos:end])
+        pos = end
+
+    return older + newest
+
+
+def varint(data, pos):
+    value = shift = 0
+    while True:
+        if pos >= len(data):
+            raise ValueError("truncated varint")
+        byte = data[pos]
+        pos += 1
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if not byte & 0x80:
+            return value, pos
+
+
+def unzigzag(value):
+    return (value >> 1) ^ -(value & 1)
+
+
+def decode(raw):
+    """Exposures as dicts, deltas before the first key are dropped."""
+    exposures = []
+    last = None
+    skipped = 0
+    for record in raw:
+        header = record[0]
+        payload = bytes(record[1:])
+        if len(payload) != header & J_LEN or payload[-1] & 0x80:
+            skipped += 1  # cut short by a reset
+            continue
+        if not header & J_KEY and last is None:
+            skipped += 1
+            continue
+
+        pos = 0
+        fields = dict(last or {})
+        try:
+            if header & J_BASE:
+                value, pos = varint(payload, pos)
+                fields["base_ds"] = value if header & J_KEY else fields["base_ds"] + unzigzag(value)
+            if header & J_PROG:
+                fields["program"] = payload[pos]
+                pos += 1
+            value, pos = varint(payload, pos)
+            fields["offset"] = unzigzag(value)
+            value, pos = varint(payload, pos)
+            fields["driven_ms"] = value if header & J_KEY else (fields["driven_ms"] + unzigzag(value)) & 0xFFFFFFFF
+        except (ValueError, IndexError, KeyError):
+            skipped += 1
+            last = None
+            continue
+
+        exposures.append(fields)
+        last = fields
+    return exposures, skipped
+
+
+def parse(data):
+    start = data.find(b"JL")
+    if start < 0 or len(data) < start + 4:
+        raise ValueError("no journal header")
+    size = data[start + 2] | data[start + 3] << 8
+    region = data[start + 4:start + 4 + size]
+    if len(region) < size:
+        raise ValueError("short journal, %d of %d bytes" % (len(region), size))
+    return region
+
+
+def render(exposures, csv=False, out=sys.stdout):
+    if csv:
+        out.write("n,base_s,offset_stops,program,step,driven_s\n")
+    else:
+        out.write("%5s %8s %7s %7s %4s %9s\n" % ("n", "base s", "stops", "program", "step", "driven s"))
+    for n, e in enumerate(exposures, 1):
+        row = (n, e["base_ds"] / 10.0, e["offset"] * FSTOP_INTERVAL,
+               e["program"] >> 3, e["program"] & 7, e["driven_ms"] / 1000.0)
+        if csv:
+            out.write("%d,%.1f,%+.1f,%d,%d,%.3f\n" % row)
+        else:
+            out.write("%5d %8.1f %+7.1f %7d %4d %9.3f\n" % row)
+
+
+def fetch(port_name, baud):
+    import serial
+
+    with serial.Serial(port_name, baud, timeout=2) as port:
+        port.reset_input_buffer()
+        port.write(b"journal\n")
+        data = port.read_until(b"JL")
+        if not data.endswith(b"JL"):
+            raise ValueError("no answer")
+        size = port.read(2)
+        return data + size + port.read(size[0] | size[1] << 8)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("port", nargs="?")
+    parser.add_argument("--baud", type=int, default=9600)
+    parser.add_argument("--file")
+    parser.add_argument("--save", help="also write the raw dump here")
+    parser.add_argument("--csv", action="store_true")
+    args = parser.parse_args()
+
+    if args.file:
+        with open(args.file, "rb") as f:
+            data = f.read()
+    elif args.port:
+        data = fetch(args.port, args.baud)
+    else:
+        parser.error("need a port or --file")
+
+    if args.save:
+        with open(args.save, "wb") as f:
+            f.write(data)
+
+    exposures, skipped = decode(records(parse(data)))
+    render(exposures, args.csv)
+    if skipped:
+        sys.stderr.write("%d records skipped, incomplete or before the oldest key\n" % skipped)
+
+
+if __name__ == "__main__":
+    main()
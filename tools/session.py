@@ -0,0 +1,128 @@
+#!/usr/bin/env python3
+"""Build a printing session and upload it to the timer.
+
+The session is a text file with one program per line: the base time
+in seconds, then the stop offset of each exposure, in half stops.
+Blank lines and anything after '#' are ignored.
+
+    # print 1, split grade
+    12.5   0 +0.5 -1
+    8      0
+
+    tools/session.py session.txt /dev/ttyUSB0          upload at 115200
+    tools/session.py session.txt /dev/ttyUSB0 --fast 250000
+    tools/session.py session.txt --save session.bin    only build the blob
+
+The blob layout and the limits mirror src/session.c and src/ui.h. The
+upload waits for the firmware's '.' after every CHUNK bytes, the rest
+of the time goes to the EEPROM writes.
+"""
+import argparse
+import binascii
+import struct
+import sys
+import time
+
+BANK_SIZE = 224         # SESSION_BANK_SIZE
+PROGRAMS = 32           # SESSION_PROGRAMS
+CHUNK = 32              # SESSION_CHUNK
+STEPS = 8               # PROGRAM_STEPS
+BASE_MIN_DS = 10
+BASE_MAX_DS = 9990
+OFFSET_MAX = 12         # PROGRAM_OFFSET_MAX
+FSTOP_INTERVAL = 0.5    # stops per offset unit, src/ui.c
+
+
+def parse(lines):
+    """(base_ds, offsets) per program, offsets in FSTOP_INTERVAL units."""
+    programs = []
+    for number, line in enumerate(lines, 1):
+        fields = line.split("#")[0].split()
+        if not fields:
+            continue
+        where = "line %d: " % number
+        base_ds = round(float(fields[0]) * 10)
+        if not BASE_MIN_DS <= base_ds <= BASE_MAX_DS:
+            raise ValueError(where + "base time out of range")
+        offsets = []
+        for field in fields[1:] or ["0"]:
+            units = float(field) / FSTOP_INTERVAL
+            if units != round(units) or abs(units) > OFFSET_MAX:
+                raise ValueError(where + "offset %s is not a half stop within 6" % field)
+            offsets.append(int(units))
+        if len(offsets) > STEPS:
+            raise ValueError(where + "more than %d steps" % STEPS)
+        programs.append((base_ds, offsets))
+    if not 1 <= len(programs) <= PROGRAMS:
+        raise ValueError("need 1 to %d programs" % PROGRAMS)
+    return programs
+
+
+def build(programs):
+    payload = bytes([len(programs)])
+    for base_ds, offsets in programs:
+        payload += struct.pack("<HB", base_ds, len(offsets))
+        payload += struct.pack("<%db" % len(offsets), *offsets)
+    blob = struct.pack("<H", len(payload)) + payload
+    blob += struct.pack("<H", binascii.crc_hqx(blob, 0xFFFF))
+    if len(blob) > BANK_SIZE:
+        raise ValueError("session takes %d bytes, the bank has %d" % (len(blob), BANK_SIZE))
+    return blob
+
+
+def expect(port, what):
+    line = port.readline().decode(errors="replace").strip()
+    if not line.startswith(what):
+        raise IOError("expected %r, got %r" % (what, line))
+    return line
+
+
+def upload(blob, port_name, baud, fast):
+    import serial
+
+    with serial.Serial(port_name, baud, timeout=2) as port:
+        port.reset_input_buffer()
+        port.write(b"load %d\n" % fast)
+        expect(port, "load ")
+        port.flush()
+        port.baudrate = fast
+
+        start = time.monotonic()
+        for at in range(0, len(blob), CHUNK):
+            chunk = blob[at:at + CHUNK]
+            port.write(chunk)
+            if at + CHUNK < len(blob) and port.read(1) != b".":
+                raise IOError("no ack after %d bytes" % (at + len(chunk)))
+        result = expect(port, "load ok")
+        elapsed = time.monotonic() - start
+        port.baudrate = baud
+
+    print("%s, %d bytes in %.2f s" % (result, len(blob), elapsed))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("session")
+    parser.add_argument("port", nargs="?")
+    parser.add_argument("--baud", type=int, default=9600)
+    parser.add_argument("--fast", type=int, default=115200, help="upload rate")
+    parser.add_argument("--save", help="also write the blob here")
+    args = parser.parse_args()
+
+    with open(args.session) as f:
+        try:
+            blob = build(parse(f))
+        except ValueError as e:
+            sys.exit("%s: %s" % (args.session, e))
+
+    if args.save:
+        with open(args.save, "wb") as f:
+            f.write(blob)
+    if args.port:
+        upload(blob, args.port, args.baud, args.fast)
+    elif not args.save:
+        parser.error("need a port or --save")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,47 @@
+#!/usr/bin/env python3
+"""Calibrate the timer's crystal against the host clock.
+
+Sends "sync <host_us>" lines at a fixed interval for a few minutes,
+then a bare "sync" which makes the firmware add the measured drift to
+its correction and save it in EEPROM.
+
+The timestamp is zero padded so every line takes the same time on the
+wire, the firmware stamps the line when its '\\n' arrives.
+
+    tools/timecal.py /dev/ttyUSB0 --minutes 5
+
+Any serial device works, including one end of a pty pair (socat) for
+trying the script without a board.
+"""
+import argparse
+import time
+
+import serial
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("port")
+    parser.add_argument("--baud", type=int, default=9600)
+    parser.add_argument("--minutes", type=float, default=5.0)
+    parser.add_argument("--interval", type=float, default=10.0, help="seconds between samples")
+    args = parser.parse_args()
+
+    with serial.Serial(args.port, args.baud, timeout=1) as port:
+        start = time.monotonic()
+        end = start + args.minutes * 60
+        next_sample = start
+
+        while next_sample <= end:
+            time.sleep(max(0.0, next_sample - time.monotonic()))
+            host_us = int((time.monotonic() - start) * 1e6) & 0xFFFFFFFF
+            port.write(b"sync %010d\n" % host_us)
+            print(port.readline().decode(errors="replace").strip())
+            next_sample += args.interval
+
+        port.write(b"sync\n")
+        print(port.readline().decode(errors="replace").strip())
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,106 @@
+#!/usr/bin/env python3
+"""Fetch and render the firmware event trace as a timeline.
+
+    tools/tracedump.py /dev/ttyUSB0       ask the board for a dump
+    tools/tracedump.py --file dump.bin    render a saved dump
+
+The dump format and ids mirror src/trace.h.
+"""
+import argparse
+import struct
+import sys
+
+IDS = {
+    1: "encoder",
+    2: "button",
+    3: "relay",
+    4: "display",
+    5: "uart-overrun",
+    6: "state",
+    7: "display-level",
+}
+
+EVENTS = ["none", "enc-cw", "enc-ccw", "click", "start", "focus", "tick",
+          "done", "timeout", "mode-print", "mode-test"]
+
+STATES = ["idle", "focus", "set-time", "running", "paused", "test-strip", "program-edit", "paper"]
+
+
+def describe(ident, arg):
+    if ident == 1:
+        return "%+d" % struct.unpack("b", bytes([arg]))[0]
+    if ident == 2:
+        return EVENTS[arg] if arg < len(EVENTS) else str(arg)
+    if ident == 3:
+        state = "on" if arg & 1 else "off"
+        return "channel %d %s" % (arg >> 1, state) if arg > 1 else state
+    if ident == 5:
+        return "buffer full" if arg else "hardware"
+    if ident == 7:
+        return "off" if arg == 16 else str(arg)
+    if ident == 6:
+        return STATES[arg] if arg < len(STATES) else str(arg)
+    return str(arg)
+
+
+def parse(data):
+    start = data.find(b"TR")
+    if start < 0 or len(data) < start + 3:
+        raise ValueError("no trace header")
+    count = data[start + 2]
+    body = data[start + 3:start + 3 + 4 * count]
+    if len(body) < 4 * count:
+        raise ValueError("short trace, %d of %d bytes" % (len(body), 4 * count))
+    entries = [struct.unpack_from("<HBB", body, 4 * i) for i in range(count)]
+    return [entry for entry in entries if entry[1]]
+
+
+def render(entries, out=sys.stdout):
+    # Ticks are the low 16 bits of the ms timebase, unwrap them.
+    elapsed = 0
+    previous = None
+    for tick, ident, arg in entries:
+        delta = 0 if previous is None else (tick - previous) & 0xFFFF
+        elapsed += delta
+        previous = tick
+        out.write("%8d ms  %+6d  %-13s %s\n" % (elapsed, delta, IDS.get(ident, ident), describe(ident, arg)))
+
+
+def fetch(port_name, baud):
+    import serial
+
+    with serial.Serial(port_name, baud, timeout=2) as port:
+        port.reset_input_buffer()
+        port.write(b"trace\n")
+        data = port.read_until(b"TR")
+        if not data.endswith(b"TR"):
+            raise ValueError("no answer")
+        count = port.read(1)
+        return data + count + port.read(4 * count[0])
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("port", nargs="?")
+    parser.add_argument("--baud", type=int, default=9600)
+    parser.add_argument("--file")
+    parser.add_argument("--save", help="also write the raw dump here")
+    args = parser.parse_args()
+
+    if args.file:
+        with open(args.file, "rb") as f:
+            data = f.read()
+    elif args.port:
+        data = fetch(args.port, args.baud)
+    else:
+        parser.error("need a port or --file")
+
+    if args.save:
+        with open(args.save, "wb") as f:
+            f.write(data)
+
+    render(parse(data))
+
+
+if __name__ == "__main__":
+    main()